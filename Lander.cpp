@@ -166,28 +166,74 @@
 using namespace std;
 
 
+#include "Lander_Bus.h"
 #include "Lander_Control.h"
+#include "Lander_Descent.h"
+#include "Lander_Env.h"
+#include "Lander_Events.h"
+#include "Lander_Policy.h"
+#include "Lander_Scan.h"
+#include "Lander_Sensors.h"
+#include "Lander_Sonar.h"
+#include "Lander_State.h"
+#include "Lander_Turn.h"
 
-int rotate_flag = 0;
-int rotate_flag_safety = 0;
-int safety = 0;
-int done = 0;
-int rotation_count = 0;
-int angle_flag = 1;
-int velocity_flag = 1;
-double angle = 0.0;
-double time_step = 0.005;
-double power;
-int first_loop = 1;
-
-void Right_Thruster_robust(double power);
-void Working_Thruster_On(double power);
-int Working_Thruster();
+/*
+  Thruster sets, a bit per working thruster. The controllers are
+  templates over the set so each combination gets its own copy with
+  the checks on MT_OK, LT_OK and RT_OK (and the choice of stand-in
+  thruster) folded away, Thrusters_Changed() switches copies when a
+  thruster fails.
+*/
+#define THR_MAIN 1
+#define THR_LEFT 2
+#define THR_RIGHT 4
+#define THR_ALL 7
+
+#define SONAR_QUIET 300	// ticks without a return before the sonar counts as out
+
+CONTROLLER_STATE int rotate_flag = 0;
+CONTROLLER_STATE int rotate_flag_safety = 0;
+CONTROLLER_STATE int safety = 0;
+CONTROLLER_STATE int done = 0;
+CONTROLLER_STATE int rotation_count = 0;
+CONTROLLER_STATE int angle_flag = 1;
+CONTROLLER_STATE int velocity_flag = 1;
+CONTROLLER_STATE double angle = 0.0;
+CONTROLLER_STATE double time_step = 0.005;
+CONTROLLER_STATE double power;
+CONTROLLER_STATE int first_loop = 1;
+CONTROLLER_STATE int righting = 0;
+CONTROLLER_STATE int looking = 0;
+CONTROLLER_STATE int polled = 0;
+CONTROLLER_STATE int descending = 0;	// Descent_Fly() has the lander
+CONTROLLER_STATE int thrusters = THR_ALL;	// working thrusters, picks the controllers below
+CONTROLLER_STATE int near_platform;	// Events_Watch() id, safety override stays off near the platform
+
+// Latest sonar sweep and the closest return in each direction, refreshed on every ping
+CONTROLLER_STATE struct Sonar_Frame sonar;
+CONTROLLER_STATE long sonar_heard = 0;	// tick of the last sweep with a return in it
+CONTROLLER_STATE double sonar_right, sonar_left, sonar_up, sonar_down;
+
+template <int ok> static void Control(int ev);
+template <int ok> static void Safety(void);
+template <int ok> static void Right_Thruster_robust(double power);
+template <int ok> static void Left_Thruster_robust(double power);
+template <int ok> static void Main_Thruster_robust(double power);
 void Set_Rotate(double angle);
-void Left_Thruster_robust(double power);
-void Main_Thruster_robust(double power);
-int Is_OK();
-void (*Thruster) (double);
+void Fire(int thruster, double power);
+double Sector(double sonar_min, int from, int to);
+int Sonar_Out(void);
+CONTROLLER_STATE int thruster;	// THR_ bit of the thruster the robust functions picked
+int Start_Tick();
+void Fly_Policy(void);
+
+static void (*const controls[8])(int) = {
+ Control<0>, Control<1>, Control<2>, Control<3>, Control<4>, Control<5>, Control<6>, Control<7>
+};
+static void (*const safeties[8])(void) = {
+ Safety<0>, Safety<1>, Safety<2>, Safety<3>, Safety<4>, Safety<5>, Safety<6>, Safety<7>
+};
 
 
 void Lander_Control(void)
@@ -242,42 +288,91 @@ void Lander_Control(void)
         I'll give you zero.
 **************************************************/
 
+ int ev = Start_Tick();
+
+ Bus_Layer(BUS_CONTROL);
+ if (Policy_Loaded()) Fly_Policy();
+ else controls[thrusters](ev);
+}
+
+template <int ok>
+static void Control(int ev)
+{
  double VXlim;
  double VYlim;
+ double look;
 
+  // Set up to touch down, nothing left to steer
+  if (done)
+   return;
 
-  if (first_loop) {
-   Thruster = Main_Thruster;
-   first_loop = 0;
+  // Over the platform and close, Descent_Fly() takes it from here
+  // whatever we were in the middle of
+  if (!descending && Descent_Ready()) {
+   rotate_flag = 0;
+   righting = 0;
+   looking = 0;
+   Descent_Start();
+   descending = 1;
+   return;
+  }
+  if (descending) {
+   Descent_Fly(ev);
+   return;
   }
- 
-
 
+  // Pointing the laser somewhere, hold altitude till it gets there
+  if (looking) {
+   if (!(ev & EV_ROTATED) && !Turn_Overdue()) {
+    Turn_Thrust();
+    return;
+   }
+   looking = 0;
+   Events_Cancel_Rotation();
+   Turn_End();
+  }
 
+  // Turning back upright, nothing to do until we get there. The turn
+  // was worked out from one noisy Angle() (and the safety override may
+  // have turned us since), so if it's taking too long ask again
+  if (righting) {
+   if (!(ev & EV_ROTATED)) {
+    if (Turn_Overdue()) Set_Rotate(0.0);
+    return;
+   }
+   righting = 0;
+   Turn_End();
+  }
 
   // let the lander rotate before turning on another truster. 
   if (rotate_flag) {
-   if (fabs(Position_X() - PLAT_X) < 40 && (PLAT_Y - Position_Y()) < 20) {
-    Left_Thruster(0);
-    Right_Thruster(0);
-    Thruster(0);
-    Main_Thruster(0);
+   if (fabs(Sensed_PX() - PLAT_X) < 40 && (PLAT_Y - Sensed_PY()) < 20) {
+    Bus_Left(0);
+    Bus_Right(0);
+    Fire(thruster, 0);
+    Bus_Main(0);
     Set_Rotate(0.0);
     done = 1;
     rotate_flag = 0;
     return;
-   } else if (fabs(angle - Angle()) > 2) {
-    Set_Rotate(angle);
+   } else if (!(ev & EV_ROTATED)) {
+    // Still turning, hold altitude with whatever faces the right way
+    // meanwhile. Set_Rotate() asked for the whole rotation, but from one
+    // noisy Angle(), and the safety override turns us too, so the
+    // rotation is corrected every tick until we get there
     rotate_flag_safety = 0;
-    //Thruster(0.0);
+    if (fabs(angle - Sensed_Angle()) > 2) Set_Rotate(angle);
+    Turn_Thrust();
     return;
    } else {
     rotate_flag_safety = 1;
     rotate_flag = 0;
+    Turn_End();
     cout << "Power: " << power << "\n";
-    Thruster(power);
+    Fire(thruster, power);
    }
   }
+
   
 
 
@@ -309,19 +404,19 @@ void Lander_Control(void)
    // move faster, decrease speed limits as the module
    // approaches landing. You may need to be more conservative
    // with velocity limits when things fail.
-   if (fabs(Position_X()-PLAT_X)>200) VXlim=25;
-   else if (fabs(Position_X()-PLAT_X)>100) VXlim=15;
+   if (fabs(Sensed_PX()-PLAT_X)>200) VXlim=25;
+   else if (fabs(Sensed_PX()-PLAT_X)>100) VXlim=15;
    else VXlim=5;
 
-   if (PLAT_Y-Position_Y()>200) VYlim=-20;
-   else if (PLAT_Y-Position_Y()>100) VYlim=-10;  // These are negative because they
-   else VYlim=-4;				       // limit descent velocity
+   if (PLAT_Y-Sensed_PY()>200) VYlim=-20;
+   else if (PLAT_Y-Sensed_PY()>100) VYlim=-15;  // These are negative because they
+   else VYlim=-8;				       // limit descent velocity
 
    // Ensure we will be OVER the platform when we land
-   if ( fabs(PLAT_X-Position_X())/fabs(Velocity_X()) > 
-    1.25*fabs(PLAT_Y-Position_Y())/fabs(Velocity_Y()) ) VYlim=1;
+   if ( fabs(PLAT_X-Sensed_PX())/fabs(Sensed_VX()) > 
+    1.25*fabs(PLAT_Y-Sensed_PY())/fabs(Sensed_VY()) ) VYlim=1;
 
-  if (Is_OK()) {
+  if (ok == THR_ALL) {
    // IMPORTANT NOTE: The code below assumes all components working
    // properly. IT MAY OR MAY NOT BE USEFUL TO YOU when components
    // fail. More likely, you will need a set of case-based code
@@ -333,39 +428,54 @@ void Lander_Control(void)
    // Note that only the latest Rotate() command has any
    // effect, i.e. the rotation angle does not accumulate
    // for successive calls.
+   // The angle noise is about as big as the 1 degree we allow,
+   // so average a few readings before deciding to turn.
 
-    if (Angle()>1&&Angle()<359)
+    // With no sonar returns, turn the laser towards where we're
+    // going if it hasn't looked there lately. Righting ourselves
+    // afterwards sweeps it back, reading as it goes.
+    if (Sonar_Out() && Scan_Due(&look))
     {
-     if (Angle()>=180) Rotate(360-Angle());
-     else Rotate(-Angle());
+     Set_Rotate(look);
+     Events_Rotation(look, 5.0);
+     looking = 1;
+     return;
+    }
+
+    Sensors_Oversample(SENSOR_ANGLE, 4);
+    if (Sensed_Angle()>1&&Sensed_Angle()<359)
+    {
+     Set_Rotate(0.0);
+     Events_Rotation(0.0, 1.0);
+     righting = 1;
      return;
     }
    
    // Module is oriented properly, check for horizontal position
    // and set thrusters appropriately.
-   if (Position_X()>PLAT_X)
+   if (Sensed_PX()>PLAT_X)
    {
     // Lander is to the LEFT of the landing platform, use Right thrusters to move
     // lander to the left.
-    Left_Thruster(0.0);	// Make sure we're not fighting ourselves here!
-    if (Velocity_X()>(-VXlim)) 
-      Right_Thruster((VXlim+fmin(0,Velocity_X()))/VXlim);
+    Bus_Left(0.0);	// Make sure we're not fighting ourselves here!
+    if (Sensed_VX()>(-VXlim)) 
+      Bus_Right((VXlim+fmin(0,Sensed_VX()))/VXlim);
     else
     {
      // Exceeded velocity limit, brake
-     Right_Thruster(0.0);
-     Left_Thruster(fabs(VXlim-Velocity_X()));
+     Bus_Right(0.0);
+     Bus_Left(fabs(VXlim-Sensed_VX()));
     }
    }
    else
    {
     // Lander is to the RIGHT of the landing platform, opposite from above
-    Right_Thruster(0);
-    if (Velocity_X()<VXlim) Left_Thruster((VXlim-fmax(0,Velocity_X()))/VXlim);
+    Bus_Right(0);
+    if (Sensed_VX()<VXlim) Bus_Left((VXlim-fmax(0,Sensed_VX()))/VXlim);
     else
     {
-     Left_Thruster(0);
-     Right_Thruster(fabs(VXlim-Velocity_X()));
+     Bus_Left(0);
+     Bus_Right(fabs(VXlim-Sensed_VX()));
     }
    }
    
@@ -373,57 +483,54 @@ void Lander_Control(void)
    // Vertical adjustments. Basically, keep the module below the limit for
    // vertical velocity and allow for continuous descent. We trust
    // Safety_Override() to save us from crashing with the ground.
-   if (Velocity_Y()<VYlim) Main_Thruster(1.0);
-   else Main_Thruster(0); 
+   if (Sensed_VY()<VYlim) Bus_Main(1.0);
+   else Bus_Main(0); 
 
   } else {
 
-   if (done)
-    return;
-
-   if (Velocity_Y() < VYlim) { 
+   if (Sensed_VY() < VYlim) { 
     safety = 1;
    }
 
    // turn on the main truster if the descent velocity is too high
    if (safety) {
-    if (Velocity_Y() < VYlim + fmin(4, 0.3*VYlim)) {
-     Main_Thruster_robust(1.0);
+    if (Sensed_VY() < VYlim + fmin(4, 0.3*VYlim)) {
+     Main_Thruster_robust<ok>(1.0);
      return;
    } else
      safety = 0;
    }
 
-   if (Position_X()>PLAT_X)
+   if (Sensed_PX()>PLAT_X)
    {
     // Lander is to the LEFT of the landing platform, use Right thrusters to move
     // lander to the left.
     // Make sure we're not fighting ourselves here!
-    if (Velocity_X()>(-VXlim)) 
-      Right_Thruster_robust((VXlim+fmin(0,Velocity_X()))/VXlim);
+    if (Sensed_VX()>(-VXlim)) 
+      Right_Thruster_robust<ok>((VXlim+fmin(0,Sensed_VX()))/VXlim);
     else
     {
      // Exceeded velocity limit, brake
-     Left_Thruster_robust(fabs(VXlim-Velocity_X()));
+     Left_Thruster_robust<ok>(fabs(VXlim-Sensed_VX()));
     }
 
    } else {
     // Lander is to the RIGHT of the landing platform, opposite from above
-    if (Velocity_X()<VXlim) 
-     Left_Thruster_robust((VXlim-fmax(0,Velocity_X()))/VXlim);
+    if (Sensed_VX()<VXlim) 
+     Left_Thruster_robust<ok>((VXlim-fmax(0,Sensed_VX()))/VXlim);
     else
     {
-     Right_Thruster_robust(fabs(VXlim-Velocity_X()));
+     Right_Thruster_robust<ok>(fabs(VXlim-Sensed_VX()));
     }
    }
 
    // if the lander is close enough to the platform prepare to land.
 
-   if (fabs(Position_X() - PLAT_X) < 50 && (PLAT_Y - Position_Y()) < 50) {
-    Left_Thruster(0);
-    Right_Thruster(0);
-    Thruster(0);
-    Main_Thruster(0);
+   if (fabs(Sensed_PX() - PLAT_X) < 50 && (PLAT_Y - Sensed_PY()) < 50) {
+    Bus_Left(0);
+    Bus_Right(0);
+    Fire(thruster, 0);
+    Bus_Main(0);
     Set_Rotate(0.0);
     done = 1;
     return;
@@ -465,105 +572,89 @@ void Safety_Override(void)
 
  
 
+ // Lander_Control() normally starts the tick, but it isn't called
+ // when flying by hand
+ if (!polled) Start_Tick();
+ polled = 0;
+
+ // If we're close to the landing platform, disable
+ // safety override (close to the landing platform
+ // the Control_Policy() should be trusted to
+ // safely land the craft)
+ Bus_Layer(BUS_SAFETY);
+ if (!rotate_flag_safety && !descending && !Events_Holds(near_platform))
+  safeties[thrusters]();
+
+ // Both controllers have had their say, this is what the lander does
+ Bus_Commit();
+}
+
+template <int ok>
+static void Safety(void)
+{
  double DistLimit;
  double Vmag;
  double dmin;
- int i_picked;
- int j;
+ double right = Sector(sonar_right, 5, 14), left = Sector(sonar_left, 22, 32);
+ double up = fmin(Sector(sonar_up, 0, 5), Sector(sonar_up, 32, 36)), down = Sector(sonar_down, 14, 22);
 
  // Establish distance threshold based on lander
  // speed (we need more time to rectify direction
  // at high speed)
- Vmag=Velocity_X()*Velocity_X();
- Vmag+=Velocity_Y()*Velocity_Y();
+ Vmag=Sensed_VX()*Sensed_VX();
+ Vmag+=Sensed_VY()*Sensed_VY();
 
  DistLimit=fmax(60,Vmag);
-
- int offset = (((int) lround(Angle() / 10)) % 36);
-
-
-
- if (rotate_flag_safety) return;
- 
-
-
- // If we're close to the landing platform, disable
- // safety override (close to the landing platform
- // the Control_Policy() should be trusted to
- // safely land the craft)
- if (fabs(PLAT_X-Position_X())<150&&fabs(PLAT_Y-Position_Y())<150) return;
  
  // Determine the closest surfaces in the direction
- // of motion. This is done by checking the sonar
- // array in the quadrant corresponding to the
- // ship's motion direction to find the entry
- // with the smallest registered distance
+ // of motion. The closest return in each quadrant
+ // is worked out by Sonar_Update() when a ping
+ // comes in, so all that's left here is to pick
+ // the quadrant matching the ship's motion
 
- if (Is_OK()) {
+ if (ok == THR_ALL) {
 
    // Horizontal direction.
- dmin=1000000;
- if (Velocity_X()>0)
- {
-  for (int i=5;i<14;i++)
-   if (SONAR_DIST[i]>-1&&SONAR_DIST[i]<dmin) dmin=SONAR_DIST[i];
- }
- else
- {
-  for (int i=22;i<32;i++)
-   if (SONAR_DIST[i]>-1&&SONAR_DIST[i]<dmin) dmin=SONAR_DIST[i];
- }
+ dmin=(Sensed_VX()>0) ? right : left;
  // Determine whether we're too close for comfort. There is a reason
  // to have this distance limit modulated by horizontal speed...
  // what is it?
- if (dmin<DistLimit*fmax(.25,fmin(fabs(Velocity_X())/5.0,1)))
+ if (dmin<DistLimit*fmax(.25,fmin(fabs(Sensed_VX())/5.0,1)))
  { // Too close to a surface in the horizontal direction
-  if (Angle()>1&&Angle()<359)
+  if (Sensed_Angle()>1&&Sensed_Angle()<359)
   {
-   if (Angle()>=180) Rotate(360-Angle());
-   else Rotate(-Angle());
+   if (Sensed_Angle()>=180) Bus_Rotate(360-Sensed_Angle());
+   else Bus_Rotate(-Sensed_Angle());
    return;
   }
 
-  if (Velocity_X()>0){
-   Right_Thruster(1.0);
-   Left_Thruster(0.0);
+  if (Sensed_VX()>0){
+   Bus_Right(1.0);
+   Bus_Left(0.0);
   }
   else
   {
-   Left_Thruster(1.0);
-   Right_Thruster(0.0);
+   Bus_Left(1.0);
+   Bus_Right(0.0);
   }
  }
 
  // Vertical direction
- dmin=1000000;
- if (Velocity_Y()>5)      // Mind this! there is a reason for it...
- {
-  for (int i=0; i<5; i++)
-   if (SONAR_DIST[i]>-1&&SONAR_DIST[i]<dmin) dmin=SONAR_DIST[i];
-  for (int i=32; i<36; i++)
-   if (SONAR_DIST[i]>-1&&SONAR_DIST[i]<dmin) dmin=SONAR_DIST[i];
- }
- else
- {
-  for (int i=14; i<22; i++)
-   if (SONAR_DIST[i]>-1&&SONAR_DIST[i]<dmin) dmin=SONAR_DIST[i];
- }
+ dmin=(Sensed_VY()>5) ? up : down;	// Mind this! there is a reason for it...
  if (dmin<DistLimit)   // Too close to a surface in the horizontal direction
  {
-  if (Angle()>1||Angle()>359)
+  if (Sensed_Angle()>1||Sensed_Angle()>359)
   {
-   if (Angle()>=180) Rotate(360-Angle());
-   else Rotate(-Angle());
+   if (Sensed_Angle()>=180) Bus_Rotate(360-Sensed_Angle());
+   else Bus_Rotate(-Sensed_Angle());
    return;
   }
-  if (Velocity_Y()>2.0){
-   Main_Thruster(0.0);
+  if (Sensed_VY()>2.0){
+   Bus_Main(0.0);
   }
   else
   {
-   Main_Thruster(1.0);
+   Bus_Main(1.0);
   }
  }
 
@@ -572,72 +663,38 @@ void Safety_Override(void)
 
 
    // Horizontal direction.
-   dmin=1000000;
-   if (Velocity_X()>0)
-   {
-    for (int i=5;i<14;i++) {
-     if (SONAR_DIST[i]>-1&&SONAR_DIST[i]<dmin) 
-      dmin=SONAR_DIST[i];
-    }
-   }
-   else
-   {
-    for (int i = 22; i < 32; i++) {
-     if (SONAR_DIST[i] > -1 && SONAR_DIST[i] < dmin) 
-      dmin=SONAR_DIST[i];
-    }
-   }
+   dmin=(Sensed_VX()>0) ? right : left;
    // Determine whether we're too close for comfort. There is a reason
    // to have this distance limit modulated by horizontal speed...
    // what is it?
 
 
    
-   if (dmin<DistLimit*fmax(.25,fmin(fabs(Velocity_X())/5.0,1)))
+   if (dmin<DistLimit*fmax(.25,fmin(fabs(Sensed_VX())/5.0,1)))
    { // Too close to a surface in the horizontal direction
     //Set_Rotate(0.0);
-    if (Velocity_X()>0){
-     Right_Thruster_robust(1.0);
+    if (Sensed_VX()>0){
+     Right_Thruster_robust<ok>(1.0);
     }
     else
     {
-     Left_Thruster_robust(1.0);
+     Left_Thruster_robust<ok>(1.0);
     }
    }
 
    // Vertical direction
-   dmin=1000000;
-   if (Velocity_Y()>5)      // Mind this! there is a reason for it...
-   {
-    for (int i=0; i<5; i++) {
-     if (SONAR_DIST[i]>-1&&SONAR_DIST[i]<dmin) 
-      dmin=SONAR_DIST[i];
-    }
-    for (int i=32; i<36; i++) {
-     j = ((i - offset)%36 < 0) ? 36 - (int) fabs((i - offset)%36): (i - offset)%36;
-     if (SONAR_DIST[i]>-1&&SONAR_DIST[i]<dmin) 
-      dmin=SONAR_DIST[i];
-    }
-   }
-   else
-   {
-    for (int i=14; i<22; i++) {
-     if (SONAR_DIST[i]>-1&&SONAR_DIST[i]<dmin) 
-      dmin=SONAR_DIST[i];
-     
-    }
-   }
+   dmin=(Sensed_VY()>5) ? up : down;	// Mind this! there is a reason for it...
 
    //cout << dmin << "\n";
    if (dmin<DistLimit)   // Too close to a surface in the vertical direction
    {
     //Set_Rotate(0.0); 
-    if (Velocity_Y()>1.0){
-     Main_Thruster_robust(0.0);
+    if (Sensed_VY()>1.0){
+     Main_Thruster_robust<ok>(0.0);
     }
     else
     {
-     Main_Thruster_robust(1.0);
+     Main_Thruster_robust<ok>(1.0);
     }
    }
   }
@@ -647,120 +704,217 @@ void Safety_Override(void)
 
 
 
-void Main_Thruster_robust(double set_power) {
+template <int ok>
+static void Main_Thruster_robust(double set_power) {
  /**
 	Function that adjust the angle of the lander, if the main 
 	thruster is not wroking, so that the right or the left 
 	thruster can be used instead.
  */
- //Thruster(0.0);
- if (MT_OK) {
+ if (ok & THR_MAIN) {
   Set_Rotate(0.0);
   angle = 0.0;
-  Right_Thruster(0.0);
-  Left_Thruster(0.0);
-  Thruster = Main_Thruster;
+  Bus_Right(0.0);
+  Bus_Left(0.0);
+  thruster = THR_MAIN;
  } else {
-  if (Working_Thruster() == 3) {
-   Left_Thruster(0);
+  if (ok & THR_RIGHT) {
+   Bus_Left(0);
    Set_Rotate(90.0);
    angle = 90.0;
-   Thruster = Right_Thruster;
+   thruster = THR_RIGHT;
   } else {
    Set_Rotate(270.0);
    angle = 270.0;
-   Right_Thruster(0.0);
-   Thruster = Left_Thruster;
+   Bus_Right(0.0);
+   thruster = THR_LEFT;
   }
  }
  rotate_flag = 1;
+ Events_Rotation(angle, 2.0);
  power = set_power;
 }
 
 
 
-void Right_Thruster_robust(double set_power) {
+template <int ok>
+static void Right_Thruster_robust(double set_power) {
  /**
  Function that adjust the angle of the lander, if the right 
  thruster is not wroking, so that the main or the left 
  thruster can be used instead.
  */
- //Thruster(0.0);
- if (RT_OK) {
+ if (ok & THR_RIGHT) {
   Set_Rotate(0.0);
   angle = 0.0;
-  Left_Thruster(0.0);
-  Main_Thruster(0.0);
-  Thruster = Right_Thruster;
+  Bus_Left(0.0);
+  Bus_Main(0.0);
+  thruster = THR_RIGHT;
  } else {
-  if (Working_Thruster() == 1) {
+  if (ok & THR_MAIN) {
    Set_Rotate(270.0);
    angle = 270.0;
-   Left_Thruster(0.0);
-   Thruster = Main_Thruster;
+   Bus_Left(0.0);
+   thruster = THR_MAIN;
   } else {
    Set_Rotate(180.0);
    angle = 180.0;
-   Thruster = Left_Thruster;
+   thruster = THR_LEFT;
   }
  }
  rotate_flag = 1;
+ Events_Rotation(angle, 2.0);
  power = set_power;
 }
 
-void Left_Thruster_robust(double set_power) {
+template <int ok>
+static void Left_Thruster_robust(double set_power) {
  /**
  Function that adjust the angle of the lander, if the left 
  thruster is not wroking, so that the main or the right 
  thruster can be used instead.
  */
- //Thruster(0.0);
- if (LT_OK) {
+ if (ok & THR_LEFT) {
   Set_Rotate(0.0);
-  Right_Thruster(0.0);
+  Bus_Right(0.0);
   angle = 0.0;
-  Main_Thruster(0.0);
-  Thruster = Left_Thruster;
+  Bus_Main(0.0);
+  thruster = THR_LEFT;
  } else {
-  if (Working_Thruster() == 1) {
+  if (ok & THR_MAIN) {
    Set_Rotate(90.0);
    angle = 90.0;
-   Right_Thruster(0.0);
-   Thruster = Main_Thruster;
+   Bus_Right(0.0);
+   thruster = THR_MAIN;
   } else {
    Set_Rotate(180.0);
    angle = 180.0;
-   Thruster = Right_Thruster;
+   thruster = THR_RIGHT;
   }
  }
  rotate_flag = 1;
+ Events_Rotation(angle, 2.0);
  power = set_power;
 }
 
 
-// Turns on the main thruster with power power
-void Working_Thruster_On(double power) {
- (MT_OK) ? Main_Thruster(power) : ((RT_OK) ? Right_Thruster(power) : Left_Thruster(power));
-}
-
-/* Returns a number for the working thruster:
-   1 - if the main thruster is working
-   2 - if the left thruster is working
-   3 - if the right thruster is working
-*/
-int Working_Thruster() { 
- return (MT_OK) ? 1 : ((RT_OK) ? 3 : 2);
+// Turns on one of the thrusters, by THR_ bit
+void Fire(int thruster, double power) {
+ if (thruster == THR_MAIN) Bus_Main(power);
+ else if (thruster == THR_LEFT) Bus_Left(power);
+ else Bus_Right(power);
 }
 
 
 // Rotate the langer such that the angle of the lander is 
-// angle from the vertical clock wise
+// angle from the vertical clock wise, the short way round
 void Set_Rotate(double angle) {
- (fabs(Angle() - angle) > 180.0) ? (((angle - Angle()) > 0.0) ? Rotate(-(360.0 - (angle - Angle()))) : Rotate((360.0 + (angle - Angle())))) : Rotate(-(Angle() - angle));
+ Turn_To(angle);
+}
+
+// Smallest valid sonar reading over beams [from, to)
+double Sonar_Min(int from, int to) {
+ double dmin = 1000000;
+ for (int i = from; i < to; i++)
+  if (((sonar.valid >> i) & 1) && sonar.dist[i] < dmin)
+   dmin = sonar.dist[i];
+ return dmin;
+}
+
+// EV_SONAR handler, readings only change on a ping so this is the only
+// place the sweep gets scanned
+void Sonar_Update(int) {
+ if (!Sonar_Read(&sonar, sonar.seq))
+  return;
+ sonar_right = Sonar_Min(5, 14);
+ sonar_left = Sonar_Min(22, 32);
+ sonar_up = fmin(Sonar_Min(0, 5), Sonar_Min(32, 36));
+ sonar_down = Sonar_Min(14, 22);
+ if (sonar.valid) sonar_heard = Events_Ticks();
+}
+
+// Sonar's closest return over a sector. Where it has none, the laser's,
+// but only as far out as the sonar could have heard unless it's out
+double Sector(double sonar_min, int from, int to) {
+ double d;
+
+ if (sonar_min < SCAN_FAR) return sonar_min;
+ d = Scan_Min(from, to);
+ return Sonar_Out() || d <= SCAN_REACH ? d : SCAN_FAR;
 }
 
-// Returns 1 of all thrusters are working
-int Is_OK() {
-  return (MT_OK && RT_OK && LT_OK) ? 1 : 0;
+// Nothing back for a while, either the sonar's dead or there's nothing
+// near enough to hear (and then looking around doesn't hurt)
+int Sonar_Out(void) {
+ return Events_Ticks() - sonar_heard > SONAR_QUIET;
 }
 
+// EV_FAILURE handler. If we were turning to use a thruster that just
+// died, drop the rotation so the next tick picks a working one
+void Thrusters_Changed(int) {
+ thrusters = (MT_OK ? THR_MAIN : 0) | (LT_OK ? THR_LEFT : 0) | (RT_OK ? THR_RIGHT : 0);
+ if (descending) {
+  descending = 0;
+  Descent_Stop();
+ }
+ if (righting || looking) {
+  righting = 0;
+  looking = 0;
+  Events_Cancel_Rotation();
+  Turn_End();
+ }
+ if (rotate_flag && !(thrusters & thruster)) {
+  rotate_flag = 0;
+  Events_Cancel_Rotation();
+  Turn_End();
+ }
+}
+
+int Near_Platform() {
+ return fabs(PLAT_X - Sensed_PX()) < 150 && fabs(PLAT_Y - Sensed_PY()) < 150;
+}
+
+// LANDER_POLICY's network in place of Control(), fed what Lander_Env.h observes
+void Fly_Policy(void) {
+ float obs[ENV_OBS], act[ENV_ACT];
+
+ obs[ENV_OBS_PX] = Sensed_PX();
+ obs[ENV_OBS_PY] = Sensed_PY();
+ obs[ENV_OBS_VX] = Sensed_VX();
+ obs[ENV_OBS_VY] = Sensed_VY();
+ obs[ENV_OBS_ANGLE] = Sensed_Angle();
+ obs[ENV_OBS_RANGE] = RangeDist();
+ for (int b = 0; b < 36; b++) obs[ENV_OBS_SONAR + b] = SONAR_DIST[b];
+ obs[ENV_OBS_MT_OK] = MT_OK;
+ obs[ENV_OBS_LT_OK] = LT_OK;
+ obs[ENV_OBS_RT_OK] = RT_OK;
+ obs[ENV_OBS_PLAT_X] = PLAT_X;
+ obs[ENV_OBS_PLAT_Y] = PLAT_Y;
+ Policy_Eval(obs, act);
+ Bus_Main(act[ENV_ACT_MAIN]);
+ Bus_Left(act[ENV_ACT_LEFT]);
+ Bus_Right(act[ENV_ACT_RIGHT]);
+ Bus_Rotate(act[ENV_ACT_ROTATE]);
+}
+
+// Runs once per tick before the controllers, returns the events that fired
+int Start_Tick() {
+ int ev;
+
+ if (first_loop) {
+  thruster = THR_MAIN;
+  Events_Subscribe(EV_SONAR, Sonar_Update);
+  Events_Subscribe(EV_FAILURE, Thrusters_Changed);
+  near_platform = Events_Watch(Near_Platform);
+  first_loop = 0;
+
+  // Once for everybody, the policy isn't per lander
+  static int policy_tried = 0;
+  if (!policy_tried && getenv("LANDER_POLICY")) Policy_Load(getenv("LANDER_POLICY"));
+  policy_tried = 1;
+ }
+ polled = 1;
+ ev = Events_Poll();
+ Scan_Tick();
+ return ev;
+}
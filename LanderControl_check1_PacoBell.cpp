@@ -167,29 +167,32 @@ using namespace std;
 
 
 #include "Lander_Control.h"
-
-int rotate_flag = 0;
-int rotate_flag_safety = 0;
-int safety = 0;
-int done = 0;
-int rotation_count = 0;
-int angle_flag = 1;
-double angle = 0.0;
-double prev_angle = 0.0;
-double power_ratio = 0.71428571428;
-double velocity [2];
-double velx, vely, posx, posy;
-double position [2];
-double position_v [2];
-int first_loop = 1;
-double dest_angle = 0.0;
-double main_power;
-double left_power;
-double right_power;
-double power;
-double bs_const = 0.02359;
-double bs_const_h = 0.0283;
-int landing_flag = 1;
+#include "Lander_Rng.h"
+#include "Lander_State.h"
+
+CONTROLLER_STATE int rotate_flag = 0;
+CONTROLLER_STATE int rotate_flag_safety = 0;
+CONTROLLER_STATE int safety = 0;
+CONTROLLER_STATE int done = 0;
+CONTROLLER_STATE int rotation_count = 0;
+CONTROLLER_STATE int angle_flag = 1;
+CONTROLLER_STATE double angle = 0.0;
+CONTROLLER_STATE double prev_angle = 0.0;
+CONTROLLER_STATE double power_ratio = 0.71428571428;
+CONTROLLER_STATE double velocity [2];
+CONTROLLER_STATE double velx, vely, posx, posy;
+CONTROLLER_STATE double position [2];
+CONTROLLER_STATE double position_v [2];
+CONTROLLER_STATE int first_loop = 1;
+CONTROLLER_STATE unsigned long dead_reckon_ticks = 0;	// counter for the jitter in update_param()
+CONTROLLER_STATE double dest_angle = 0.0;
+CONTROLLER_STATE double main_power;
+CONTROLLER_STATE double left_power;
+CONTROLLER_STATE double right_power;
+CONTROLLER_STATE double power;
+CONTROLLER_STATE double bs_const = 0.02359;
+CONTROLLER_STATE double bs_const_h = 0.0283;
+CONTROLLER_STATE int landing_flag = 1;
 
 
 void Right_Thruster_robust(double power);
@@ -565,8 +568,9 @@ void update_param() {
   } else {
    velocity[0] += T_STEP*a_x;
    velocity[1] += T_STEP*a_y;
-   position[0] += velocity[0]*T_STEP*S_SCALE + ((double)rand()/RAND_MAX - 0.5);
-   position[1] -= velocity[1]*T_STEP*S_SCALE - ((double)rand()/RAND_MAX - 0.5);
+   position[0] += velocity[0]*T_STEP*S_SCALE + (Rng_Uniform(Lander_Seed(), Lander_Id(), dead_reckon_ticks, RNG_CONTROL, 0) - 0.5);
+   position[1] -= velocity[1]*T_STEP*S_SCALE - (Rng_Uniform(Lander_Seed(), Lander_Id(), dead_reckon_ticks, RNG_CONTROL, 1) - 0.5);
+   dead_reckon_ticks++;
    position_v[0] += velx*T_STEP*S_SCALE;
    position_v[1] -= vely*T_STEP*S_SCALE;
 
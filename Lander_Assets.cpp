@@ -0,0 +1,57 @@
+/*
+	The standard images, built in (see Lander_Assets.h).
+
+	Each .bake file is pulled into .rodata whole by the assembler, so
+	this needs make to have baked them first (Lander_Assets.o depends
+	on them in the Makefile) and to be compiled from the directory they
+	are in.
+*/
+
+#include <string.h>
+
+#include "Lander_Assets.h"
+#include "Lander_Kernel.h"
+
+#define BAKED(sym, file)                                                                      \
+ extern "C" const unsigned char sym[];                                                       \
+ __asm__(".section .rodata\n.balign 64\n.type " #sym ", @object\n" #sym ":\n.incbin \"" file \
+         "\"\n.previous\n")
+
+BAKED(baked_easy, "easy.bake");
+BAKED(baked_hard, "hard.bake");
+BAKED(baked_lander, "lander.bake");
+BAKED(baked_varis, "varis.bake");
+
+static const struct {
+ const char *name;
+ const unsigned char *data;
+} baked[] = {
+ {"easy.ppm", baked_easy},
+ {"hard.ppm", baked_hard},
+ {"lander.ppm", baked_lander},
+ {"varis.ppm", baked_varis},
+};
+
+/*
+  A .bake from a different build of the mask (or a bad one) is passed
+  over, and the file on disk read instead.
+*/
+int Asset_Find(const char *filename, struct Asset *a)
+{
+ for (size_t k = 0; k < sizeof(baked) / sizeof(baked[0]); k++) {
+  const struct Asset_Head *h = (const struct Asset_Head *) baked[k].data;
+
+  if (strcmp(filename, baked[k].name)) continue;
+  if (memcmp(h->magic, ASSET_MAGIC, 4) || h->version != ASSET_VERSION ||
+      (h->mask_size && (size_t) h->mask_size != sizeof(struct Terrain_Mask)))
+   return 0;
+  a->width = h->width;
+  a->height = h->height;
+  a->rgb = baked[k].data + ASSET_ALIGN;
+  a->mask = h->mask_size ? (const struct Terrain_Mask *) (a->rgb + ASSET_PIXELS(h->width, h->height)) : NULL;
+  a->plat_x = h->plat_x;
+  a->plat_y = h->plat_y;
+  return 1;
+ }
+ return 0;
+}
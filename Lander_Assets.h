@@ -0,0 +1,51 @@
+#ifndef _LANDER_ASSETS_H
+#define _LANDER_ASSETS_H
+
+/*
+  The standard images, built into the programs.
+
+  easy.ppm, hard.ppm, lander.ppm and varis.ppm are baked at build time
+  (Lander_Bake, one .bake file each) into the form the programs use
+  them in: the RGB pixels, and for a map its Terrain_Mask and where
+  the platform is as well. Lander_Assets.o links them in as read-only,
+  64 byte aligned data, so they're paged in from the binary as they're
+  touched rather than read and parsed.
+
+  Asked for by those bare names, readPPMimage() hands out a copy of
+  the built in image and Swarm_Create() uses a built in map as it is,
+  with no mask to build and no platform to look for, so a swarm gets
+  to its first tick without touching the disk, from any directory.
+  A path (./easy.ppm, maps/easy.ppm) always reads the file, and
+  editing one of the standard images and running make bakes it again.
+*/
+
+#include <stddef.h>
+
+#define ASSET_MAGIC "LBAK"
+#define ASSET_VERSION 1
+#define ASSET_ALIGN 64
+// Bytes of pixels in an asset, padded so the mask after them is aligned
+#define ASSET_PIXELS(w, h) (((size_t) (w) * (h) * 3 + ASSET_ALIGN - 1) & ~(size_t) (ASSET_ALIGN - 1))
+
+struct Terrain_Mask;
+
+// The start of a .bake file, padded to ASSET_ALIGN, then the pixels, then the mask
+struct Asset_Head {
+ char magic[4];
+ int version;
+ int width, height;
+ int mask_size;			// sizeof(struct Terrain_Mask) for a map, 0 otherwise
+ double plat_x, plat_y;		// maps only
+};
+
+struct Asset {
+ int width, height;
+ const unsigned char *rgb;
+ const struct Terrain_Mask *mask;	// NULL if not a map
+ double plat_x, plat_y;
+};
+
+// Fills in a with the built in asset called filename, 0 if there isn't one
+int Asset_Find(const char *filename, struct Asset *a);
+
+#endif
@@ -0,0 +1,69 @@
+/*
+	Bakes an image into the form it's built into the programs in (see
+	Lander_Assets.h). Run by make, not normally by hand.
+
+	Usage: Lander_Bake image.ppm output.bake
+
+	Writes the Asset_Head, then the RGB pixels, and for a 1024x1024 map
+	its Terrain_Mask and platform, worked out with the same code the
+	swarm uses at run time.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Lander_Assets.h"
+#include "Lander_Kernel.h"
+
+unsigned char *PPM_Read(const char *filename, int *width, int *height);
+
+// What's being baked can't come from what's baked
+int Asset_Find(const char *, struct Asset *)
+{
+ return 0;
+}
+
+int main(int argc, char *argv[])
+{
+ static unsigned char head[ASSET_ALIGN];
+ struct Asset_Head h;
+ struct Terrain_Mask *mask = NULL;
+ unsigned char *im, *pixels;
+ FILE *f;
+ int ok;
+
+ if (argc != 3) {
+  fprintf(stderr, "Usage: Lander_Bake image.ppm output.bake\n");
+  return 1;
+ }
+ memset(&h, 0, sizeof(h));
+ if (!(im = PPM_Read(argv[1], &h.width, &h.height))) return 1;
+ memcpy(h.magic, ASSET_MAGIC, 4);
+ h.version = ASSET_VERSION;
+ if (h.width == SWARM_MAP_SIZE && h.height == SWARM_MAP_SIZE) {
+  if (!(mask = Terrain_Mask_Build(im))) return 1;
+  h.mask_size = sizeof(struct Terrain_Mask);
+  Terrain_Platform(im, &h.plat_x, &h.plat_y);
+ }
+ memcpy(head, &h, sizeof(h));
+ if (!(pixels = (unsigned char *) calloc(1, ASSET_PIXELS(h.width, h.height)))) return 1;
+ memcpy(pixels, im, (size_t) h.width * h.height * 3);
+
+ if (!(f = fopen(argv[2], "wb"))) {
+  perror(argv[2]);
+  return 1;
+ }
+ ok = fwrite(head, sizeof(head), 1, f) == 1 && fwrite(pixels, ASSET_PIXELS(h.width, h.height), 1, f) == 1 &&
+      (!mask || fwrite(mask, sizeof(*mask), 1, f) == 1);
+ ok = !fclose(f) && ok;
+ if (!ok) {
+  fprintf(stderr, "%s: write failed\n", argv[2]);
+  remove(argv[2]);
+  return 1;
+ }
+ free(im);
+ free(pixels);
+ free(mask);
+ return 0;
+}
@@ -0,0 +1,75 @@
+/*
+	Actuator command bus (see Lander_Bus.h).
+*/
+
+#include "Lander_Bus.h"
+#include "Lander_Control.h"
+#include "Lander_State.h"
+
+CONTROLLER_STATE static int layer = BUS_CONTROL;
+CONTROLLER_STATE static int wanted[BUS_LAYERS];	// bit per actuator submitted this tick
+CONTROLLER_STATE static double intent[BUS_LAYERS][BUS_ACTUATORS];
+CONTROLLER_STATE static int sent = 0;			// bit per thruster with a command in force
+CONTROLLER_STATE static double power[BUS_ROTATE];	// and what it was
+
+// Submissions from here on come from layer l
+void Bus_Layer(int l)
+{
+ layer = l;
+}
+
+void Bus_Submit(int actuator, double value)
+{
+ wanted[layer] |= 1 << actuator;
+ intent[layer][actuator] = value;
+}
+
+void Bus_Main(double power)
+{
+ Bus_Submit(BUS_MAIN, power);
+}
+
+void Bus_Left(double power)
+{
+ Bus_Submit(BUS_LEFT, power);
+}
+
+void Bus_Right(double power)
+{
+ Bus_Submit(BUS_RIGHT, power);
+}
+
+void Bus_Rotate(double angle)
+{
+ Bus_Submit(BUS_ROTATE, angle);
+}
+
+/*
+  Sends this tick's commands. Rotate() always goes out when asked for,
+  it's relative to wherever the lander is pointing by then.
+*/
+void Bus_Commit(void)
+{
+ static void (*const thruster[BUS_ROTATE])(double) = {Main_Thruster, Left_Thruster, Right_Thruster};
+ const int ok[BUS_ROTATE] = {MT_OK, LT_OK, RT_OK};
+
+ for (int a = 0; a < BUS_ACTUATORS; a++) {
+  int l = BUS_LAYERS - 1;
+  double v;
+
+  // A failed thruster is at 0 whatever we said, say it again if it comes back
+  if (a < BUS_ROTATE && !ok[a]) sent &= ~(1 << a);
+
+  while (l >= 0 && !(wanted[l] & (1 << a))) l--;
+  if (l < 0) continue;
+  v = intent[l][a];
+  if (a == BUS_ROTATE) Rotate(v);
+  else if (!(sent & (1 << a)) || power[a] != v) {
+   thruster[a](v);
+   sent |= 1 << a;
+   power[a] = v;
+  }
+ }
+ for (int l = 0; l < BUS_LAYERS; l++) wanted[l] = 0;
+ layer = BUS_CONTROL;
+}
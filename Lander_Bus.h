@@ -0,0 +1,39 @@
+#ifndef _LANDER_BUS_H
+#define _LANDER_BUS_H
+
+/*
+  Actuator command bus.
+
+  Lander_Control() and Safety_Override() both drive the thrusters and
+  Rotate(), so within a tick a thruster could be set by one, reset,
+  set again by the other, and only the last write counted. Instead
+  each layer now submits what it wants through the bus, and once a
+  tick Bus_Commit() resolves every actuator to the wish of the highest
+  priority layer that asked for it and sends that to the simulator,
+  skipping thruster calls that wouldn't change anything. An actuator
+  nobody asked about keeps doing what it was doing.
+
+  Within a layer the last submission wins.
+*/
+
+// Layers, later ones win
+#define BUS_CONTROL 0
+#define BUS_SAFETY 1
+#define BUS_LAYERS 2
+
+// Actuators
+#define BUS_MAIN 0
+#define BUS_LEFT 1
+#define BUS_RIGHT 2
+#define BUS_ROTATE 3
+#define BUS_ACTUATORS 4
+
+void Bus_Layer(int layer);
+void Bus_Submit(int actuator, double value);
+void Bus_Main(double power);
+void Bus_Left(double power);
+void Bus_Right(double power);
+void Bus_Rotate(double angle);
+void Bus_Commit(void);
+
+#endif
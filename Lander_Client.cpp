@@ -0,0 +1,153 @@
+/*
+	Controllers in their own process, flying a swarm over a link
+	(see Lander_Link.h).
+
+	Usage: Lander_Client link
+
+	Normally started by Lander_Swarm -R, which passes the link's name.
+	Runs Lander_Control() and Safety_Override() for every lander in
+	the link, each with its own controller instance as in the swarm,
+	and answers the controller API from the lander's slot.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+#include "Lander_Control.h"
+#include "Lander_Link.h"
+#include "Lander_Sensors.h"
+#include "Lander_State.h"
+
+int MT_OK = 1;
+int RT_OK = 1;
+int LT_OK = 1;
+double PLAT_X;
+double PLAT_Y;
+double SONAR_DIST[36];
+
+static struct Link_Slot *slot;	// lander being controlled
+static int taken[SENSORS];	// of its readings for Sensor_Mean() this tick
+
+void Main_Thruster(double power)
+{
+ slot->cmd.set |= LINK_MAIN;
+ slot->cmd.main = power;
+}
+
+void Left_Thruster(double power)
+{
+ slot->cmd.set |= LINK_LEFT;
+ slot->cmd.left = power;
+}
+
+void Right_Thruster(double power)
+{
+ slot->cmd.set |= LINK_RIGHT;
+ slot->cmd.right = power;
+}
+
+void Rotate(double angle)
+{
+ slot->cmd.set |= LINK_ROTATE;
+ slot->cmd.rotate = angle;
+}
+
+double Velocity_X(void)
+{
+ return slot->obs.vx;
+}
+
+double Velocity_Y(void)
+{
+ return slot->obs.vy;
+}
+
+double Position_X(void)
+{
+ return slot->obs.px;
+}
+
+double Position_Y(void)
+{
+ return slot->obs.py;
+}
+
+double Angle(void)
+{
+ return slot->obs.angle;
+}
+
+double RangeDist(void)
+{
+ return slot->obs.range;
+}
+
+/*
+  Sensors_Oversample()'s averaging, over the next n of the readings
+  the server sent. Angles are averaged as offsets from the first one,
+  as in Sensor_Mean_Sampled().
+*/
+double Sensor_Mean(int sensor, int n)
+{
+ const double *r = slot->obs.samples[sensor];
+ double first = r[taken[sensor]++ % LINK_SAMPLES], sum = 0, mean;
+
+ for (int i = 1; i < n; i++) {
+  double d = r[taken[sensor]++ % LINK_SAMPLES] - first;
+  sum += sensor == SENSOR_ANGLE ? remainder(d, 360.0) : d;
+ }
+ mean = first + sum / n;
+ if (sensor == SENSOR_ANGLE) mean = fmod(mean + 360.0, 360.0);
+ return mean;
+}
+
+int main(int argc, char *argv[])
+{
+ struct Link *l;
+ size_t ctl_size = __stop_lander_state - __start_lander_state;
+ char *ctl;
+ unsigned int seen = 0;
+
+ if (argc != 2) {
+  fprintf(stderr, "Usage: Lander_Client link\n");
+  return 1;
+ }
+ l = Link_Open(argv[1]);
+ if (!l) {
+  fprintf(stderr, "Lander_Client: no link %s (or it's from a different build)\n", argv[1]);
+  return 1;
+ }
+
+ // Every lander starts from the controllers' initial state
+ ctl = (char *) malloc(l->n * ctl_size);
+ if (!ctl) return 1;
+ for (int i = 0; i < l->n; i++) memcpy(ctl + i * ctl_size, __start_lander_state, ctl_size);
+ std::cout.setstate(std::ios::badbit);
+
+ while (Link_Wait(&l->tick_seq, seen, 0)) {
+  seen = __atomic_load_n(&l->tick_seq, __ATOMIC_ACQUIRE);
+  if (l->finished) break;
+  for (int i = 0; i < l->n; i++) {
+   slot = &l->slot[i];
+   if (!slot->obs.flying) continue;
+   MT_OK = slot->obs.mt_ok;
+   LT_OK = slot->obs.lt_ok;
+   RT_OK = slot->obs.rt_ok;
+   PLAT_X = slot->obs.plat_x;
+   PLAT_Y = slot->obs.plat_y;
+   memcpy(SONAR_DIST, slot->obs.sonar, sizeof(SONAR_DIST));
+   memset(taken, 0, sizeof(taken));
+   memcpy(__start_lander_state, ctl + i * ctl_size, ctl_size);
+   Lander_Control();
+   Safety_Override();
+   memcpy(ctl + i * ctl_size, __start_lander_state, ctl_size);
+  }
+  Link_Post(&l->done_seq, seen);
+ }
+ Link_Close(l, argv[1], 0);
+ free(ctl);
+ return 0;
+}
@@ -0,0 +1,174 @@
+/*
+	Terminal descent (see Lander_Descent.h).
+
+	Heights are pixels between the bottom of the hull and the top of
+	the platform, which is what RangeDist() reads upright, and speeds
+	are m/s downwards.
+*/
+
+#include <math.h>
+
+#include "Lander_Bus.h"
+#include "Lander_Control.h"
+#include "Lander_Descent.h"
+#include "Lander_Events.h"
+#include "Lander_Sensors.h"
+#include "Lander_State.h"
+#include "Lander_Turn.h"
+
+#define DESCENT_OFF 0
+#define DESCENT_TURN 1		// turning, then on to next
+#define DESCENT_BURN 2		// upright on the main thruster
+#define DESCENT_SIDE 3		// on the stand-in
+#define DESCENT_DROP 4		// upright, falling the last few pixels
+
+#define TURN_TIME .15		// seconds to get onto the stand-in, with some to spare
+#define PAD_TOP 21		// pixels from the hull's bottom to its centre, plus from the platform's top to PLAT_Y
+
+CONTROLLER_STATE static int phase = DESCENT_OFF;
+CONTROLLER_STATE static int next;	// phase after the turn
+CONTROLLER_STATE static double height;	// pixels
+CONTROLLER_STATE static double side;	// angle the stand-in holds the lander up at
+
+// Degrees off angle, either way round
+static double Off(double a, double angle)
+{
+ double d = fmod(fabs(a - angle), 360.0);
+
+ return fmin(d, 360 - d);
+}
+
+// Power that pushes accel on average out of a thruster rated max,
+// Power() in the simulator gives .95 of what's asked plus up to .05
+static double Power_For(double accel, double max)
+{
+ return fmax(0, fmin((accel / max - .025) / .95, 1));
+}
+
+/*
+  Push to follow the profile down to speed at height h: braking at
+  DESCENT_DECEL on top of holding up against gravity when on it, more
+  when coming down faster, and none at all once well under it.
+*/
+static double Push(double h, double speed)
+{
+ double profile = sqrt(speed * speed + 2 * DESCENT_DECEL * fmax(0, h) / S_SCALE);
+
+ return fmax(0, G_ACCEL + DESCENT_DECEL + DESCENT_GAIN * (-Sensed_VY() - profile));
+}
+
+// Upright, steer over the middle of the platform with whatever's left
+static void Hold_Over(void)
+{
+ double want = fmax(-1, fmin((PLAT_X - Sensors_Oversample(SENSOR_PX, 8)) / S_SCALE, 1));
+ double push = DESCENT_GAIN * (want - Sensed_VX());
+
+ if (LT_OK) Bus_Left(push > 0 ? Power_For(push, LT_ACCEL) : 0);
+ if (RT_OK) Bus_Right(push < 0 ? Power_For(-push, RT_ACCEL) : 0);
+}
+
+// Turn to angle holding up on the way, then go on to then
+static void Turn(double angle, int then)
+{
+ Turn_To(angle);
+ Events_Rotation(angle, 2.0);
+ phase = DESCENT_TURN;
+ next = then;
+}
+
+/*
+  Over the platform, not drifting off it, and low enough. Upright, the
+  laser says how low; any other way up it's the position sensor.
+  Without the main thruster there has to be a stand-in, and room to
+  turn onto it and stop.
+*/
+int Descent_Ready(void)
+{
+ double h, v, stop;
+
+ // One noisy sample to rule out being nowhere near, a few to be sure
+ if (fabs(Sensed_PX() - PLAT_X) > 2 * DESCENT_WIDTH || fabs(Sensed_VX()) > DESCENT_DRIFT) return 0;
+ if (!MT_OK && !LT_OK && !RT_OK) return 0;
+ h = Off(Sensed_Angle(), 0) < DESCENT_TILT ? RangeDist() : PLAT_Y - Sensed_PY() - PAD_TOP;
+ if (h < 0 || h > DESCENT_HEIGHT) return 0;
+ if (fabs(Sensors_Oversample(SENSOR_PX, 8) - PLAT_X) > DESCENT_WIDTH) return 0;
+ if (MT_OK) return 1;
+ v = fmax(0, -Sensed_VY());
+ stop = (v * TURN_TIME + v * v / (2 * DESCENT_DECEL)) * S_SCALE;
+ return stop < h - DESCENT_RELEASE;
+}
+
+void Descent_Start(void)
+{
+ double a = Sensors_Oversample(SENSOR_ANGLE, 4);
+
+ Events_Cancel_Rotation();
+ Turn_End();
+ Bus_Main(0);
+ Bus_Left(0);
+ Bus_Right(0);
+ if (Off(a, 0) < DESCENT_TILT) height = RangeDist();
+ else height = PLAT_Y - Sensors_Oversample(SENSOR_PY, 16) - PAD_TOP;
+
+ side = RT_OK ? 90.0 : 270.0;
+ if (MT_OK) {
+  if (Off(a, 0) < DESCENT_TILT) phase = DESCENT_BURN;
+  else Turn(0.0, DESCENT_BURN);
+ } else {
+  if (Off(a, side) < DESCENT_TILT) phase = DESCENT_SIDE;
+  else Turn(side, DESCENT_SIDE);
+ }
+}
+
+void Descent_Fly(int ev)
+{
+ double r;
+
+ // The laser when it's looking down, otherwise carry the height on
+ r = phase == DESCENT_BURN || phase == DESCENT_DROP ? RangeDist() : -1;
+ if (r >= 0) height = r;
+ else height += Sensed_VY() * S_SCALE * T_STEP;
+
+ if (phase == DESCENT_TURN) {
+  if (!(ev & EV_ROTATED) && !Turn_Overdue()) {
+   Turn_Thrust();
+   return;
+  }
+  Events_Cancel_Rotation();
+  Turn_End();
+  phase = next;
+ }
+
+ switch (phase) {
+ case DESCENT_BURN:
+  Bus_Main(Power_For(Push(height, DESCENT_CONTACT), MT_ACCEL));
+  Hold_Over();
+  return;
+
+ case DESCENT_SIDE:
+  if (height > DESCENT_RELEASE) {
+   double p = Power_For(Push(height - DESCENT_RELEASE, DESCENT_CREEP), side == 90.0 ? RT_ACCEL : LT_ACCEL);
+
+   if (side == 90.0) Bus_Right(p);
+   else Bus_Left(p);
+   return;
+  }
+  Turn(0.0, DESCENT_DROP);
+  Turn_Thrust();
+  return;
+
+ case DESCENT_DROP:
+  Hold_Over();
+  return;
+ }
+}
+
+// A thruster failed, the controller has the lander back
+void Descent_Stop(void)
+{
+ if (phase == DESCENT_TURN) {
+  Events_Cancel_Rotation();
+  Turn_End();
+ }
+ phase = DESCENT_OFF;
+}
@@ -0,0 +1,47 @@
+#ifndef _LANDER_DESCENT_H
+#define _LANDER_DESCENT_H
+
+/*
+  Terminal descent, the last DESCENT_HEIGHT pixels onto the platform.
+
+  Control() gets within 50 pixels of the platform (40 by 20 after
+  swapping thrusters), cuts everything, stands the lander up and lets
+  it drop, so how hard it comes down is luck, and everything above
+  had to come down slowly to keep the luck good. That's only a last
+  resort now: once the lander is over the platform, low and not
+  drifting off, whatever the controller was in the middle of,
+  Descent_Start() hands it to Descent_Fly() to bring down.
+
+  With the main thruster, the lander stays upright with RangeDist()
+  (which looks straight down out of the main thruster, and never
+  fails) reading the height every tick. It falls freely until braking
+  at DESCENT_DECEL would just get it to the platform at
+  DESCENT_CONTACT, then burns to follow that profile down, taking out
+  thruster noise and its own errors on the way.
+
+  Without it, the thruster standing in for it has the lander on its
+  side and the laser looking sideways. The laser's height is taken
+  when the descent starts if the lander is upright (the position
+  sensor's if not) and carried down on the vertical velocity. The
+  lander turns onto the stand-in, flies the same profile down to
+  DESCENT_RELEASE pixels at DESCENT_CREEP, then turns back upright,
+  holding itself up on the stand-in for as much of the turn as it
+  can, and drops the last few pixels.
+*/
+
+#define DESCENT_HEIGHT 100.0	// pixels above the platform it takes over at
+#define DESCENT_WIDTH 20.0	// pixels off the platform's centre it takes over within
+#define DESCENT_DRIFT 3.0	// m/s sideways it takes over under
+#define DESCENT_TILT 6.0	// degrees off upright that still counts as upright
+#define DESCENT_DECEL 12.0	// m/s^2 braking the profile plans on
+#define DESCENT_GAIN 10.0	// m/s^2 more per m/s off the profile
+#define DESCENT_CONTACT 2.0	// m/s at the platform
+#define DESCENT_RELEASE 2.0	// pixels up the stand-in lets go at
+#define DESCENT_CREEP .5	// m/s down it lets go at
+
+int Descent_Ready(void);
+void Descent_Start(void);
+void Descent_Fly(int ev);
+void Descent_Stop(void);
+
+#endif
@@ -0,0 +1,113 @@
+/*
+	Batched lander environments (see Lander_Env.h).
+
+	A swarm with a pilot that reads the action array in place of the
+	controllers, and the controller API read back once per step for
+	the observations.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Lander_Control.h"
+#include "Lander_Env.h"
+#include "Lander_Swarm.h"
+
+// The swarm calls this for every lander still flying, API already on it
+static void Pilot(struct Swarm *s, int i)
+{
+ const float *a = ((struct Env *) s->pilot_arg)->act + i * ENV_ACT;
+
+ Main_Thruster(a[ENV_ACT_MAIN]);
+ Left_Thruster(a[ENV_ACT_LEFT]);
+ Right_Thruster(a[ENV_ACT_RIGHT]);
+ Rotate(a[ENV_ACT_ROTATE]);
+}
+
+static void Observe(struct Env *e, int i)
+{
+ float *o = e->obs + i * ENV_OBS;
+
+ Swarm_Select(e->s, i);
+ o[ENV_OBS_PX] = Position_X();
+ o[ENV_OBS_PY] = Position_Y();
+ o[ENV_OBS_VX] = Velocity_X();
+ o[ENV_OBS_VY] = Velocity_Y();
+ o[ENV_OBS_ANGLE] = Angle();
+ o[ENV_OBS_RANGE] = RangeDist();
+ for (int b = 0; b < 36; b++) o[ENV_OBS_SONAR + b] = SONAR_DIST[b];
+ o[ENV_OBS_MT_OK] = MT_OK;
+ o[ENV_OBS_LT_OK] = LT_OK;
+ o[ENV_OBS_RT_OK] = RT_OK;
+ o[ENV_OBS_PLAT_X] = PLAT_X;
+ o[ENV_OBS_PLAT_Y] = PLAT_Y;
+}
+
+struct Env *Env_Create(const char *map, int n, unsigned int seed, double limit)
+{
+ struct Env *e = (struct Env *) calloc(1, sizeof(struct Env));
+
+ if (!e) return NULL;
+ if (!(e->s = Swarm_Create(map, n, seed))) {
+  free(e);
+  return NULL;
+ }
+ e->n = n;
+ e->limit = limit;
+ e->obs = (float *) calloc(n * ENV_OBS, sizeof(float));
+ e->act = (float *) calloc(n * ENV_ACT, sizeof(float));
+ e->reward = (float *) calloc(n, sizeof(float));
+ e->done = (unsigned char *) calloc(n, 1);
+ if (!e->obs || !e->act || !e->reward || !e->done) {
+  Env_Free(e);
+  return NULL;
+ }
+ e->s->pilot = Pilot;
+ e->s->pilot_arg = e;
+ for (int i = 0; i < n; i++) Observe(e, i);
+ return e;
+}
+
+void Env_Free(struct Env *e)
+{
+ Swarm_Free(e->s);
+ free(e->obs); free(e->act); free(e->reward); free(e->done);
+ free(e);
+}
+
+// Every environment flies plan p from its next reset on (and from now, before the first step)
+void Env_Faults(struct Env *e, const struct Fault_Plan *p)
+{
+ for (int i = 0; i < e->n; i++) Swarm_Faults(e->s, i, p);
+}
+
+// Starts over the environments with which[i] set, or all of them if which is NULL
+void Env_Reset(struct Env *e, const unsigned char *which)
+{
+ for (int i = 0; i < e->n; i++)
+  if (!which || which[i]) {
+   Swarm_Reset(e->s, i);
+   e->done[i] = 0;
+   e->reward[i] = 0;
+   Observe(e, i);
+  }
+}
+
+// One tick of every environment that isn't done, with the actions in e->act
+void Env_Step(struct Env *e)
+{
+ struct Swarm *s = e->s;
+ long timeout = (long) (e->limit / T_STEP);
+
+ Swarm_Step(s);
+ for (int i = 0; i < e->n; i++) {
+  if (e->done[i]) continue;
+  if (!s->status[i] && s->tick - s->launch[i] >= timeout) {
+   s->status[i] = SWARM_TIMEOUT;
+   s->end_tick[i] = s->tick;
+  }
+  e->reward[i] = s->status[i] == SWARM_LANDED ? 1 : s->status[i] == SWARM_CRASHED || s->status[i] == SWARM_LOST ? -1 : 0;
+  e->done[i] = s->status[i] != SWARM_FLYING;
+  Observe(e, i);
+ }
+}
@@ -0,0 +1,68 @@
+#ifndef _LANDER_ENV_H
+#define _LANDER_ENV_H
+
+/*
+  Batched lander environments, for training learned controllers.
+
+  The simulator only runs under glutMainLoop(), flying Lander.cpp. An
+  Env is a swarm (Lander_Swarm.h) flown by whoever calls Env_Step()
+  instead: all n environments step together, reading their actions
+  from one float array and writing observations, rewards and done
+  flags to others, all allocated once in Env_Create() and laid out
+  environment by environment.
+
+  An observation is what the controller API would have said this
+  tick, noise and failures included: the sensors, RangeDist(),
+  SONAR_DIST[] and MT_OK/LT_OK/RT_OK, plus where the platform is. An
+  action is the powers for Main_Thruster(), Left_Thruster() and
+  Right_Thruster() and the argument to Rotate() (degrees, relative,
+  replacing any rotation still under way), applied with the
+  simulator's actuator noise.
+
+  The reward is 1 on landing, -1 on crashing or leaving the map, and
+  0 otherwise, anything shaped has to be worked out from the
+  observations. done[i] is set on the step an environment's flight
+  ends (timing out after limit seconds included), and it stays put
+  until Env_Reset() starts it again.
+*/
+
+#define ENV_OBS_PX 0
+#define ENV_OBS_PY 1
+#define ENV_OBS_VX 2
+#define ENV_OBS_VY 3
+#define ENV_OBS_ANGLE 4		// degrees
+#define ENV_OBS_RANGE 5		// RangeDist()
+#define ENV_OBS_SONAR 6		// SONAR_DIST[0..35]
+#define ENV_OBS_MT_OK 42
+#define ENV_OBS_LT_OK 43
+#define ENV_OBS_RT_OK 44
+#define ENV_OBS_PLAT_X 45
+#define ENV_OBS_PLAT_Y 46
+#define ENV_OBS 47
+
+#define ENV_ACT_MAIN 0
+#define ENV_ACT_LEFT 1
+#define ENV_ACT_RIGHT 2
+#define ENV_ACT_ROTATE 3
+#define ENV_ACT 4
+
+struct Swarm;
+struct Fault_Plan;
+
+struct Env {
+ int n;
+ struct Swarm *s;
+ double limit;		// seconds before a flight times out
+ float *obs;		// n * ENV_OBS
+ float *act;		// n * ENV_ACT, filled in by the caller
+ float *reward;		// n
+ unsigned char *done;	// n
+};
+
+struct Env *Env_Create(const char *map, int n, unsigned int seed, double limit);
+void Env_Free(struct Env *e);
+void Env_Faults(struct Env *e, const struct Fault_Plan *p);
+void Env_Reset(struct Env *e, const unsigned char *which);
+void Env_Step(struct Env *e);
+
+#endif
@@ -0,0 +1,96 @@
+/*
+	Throughput check for the batched environments (Lander_Env.h).
+
+	Usage: Lander_Env [-s seed] [-t seconds] [-k steps] [-f plan] [-F faults] map envs
+
+	e.g.   Lander_Env -k 2000 hard.ppm 4096
+
+	Steps envs environments k times (default 1000) on one core with a
+	crude policy (stay upright, ease the descent, drift towards the
+	platform), starting each one over as soon as it's done, and
+	reports environment steps per second and how the flights ended.
+	-t is the time limit per flight (default 120 simulated seconds),
+	-f and -F add a fault plan as for Lander_Swarm.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Lander_Env.h"
+#include "Lander_Faults.h"
+#include "Lander_Swarm.h"
+
+static const char *outcome[] = {"flying", "crashed", "landed", "lost", "timed out"};
+
+static void Policy(const float *o, float *a)
+{
+ double angle = o[ENV_OBS_ANGLE] > 180 ? o[ENV_OBS_ANGLE] - 360 : o[ENV_OBS_ANGLE];
+ double dx = o[ENV_OBS_PLAT_X] - o[ENV_OBS_PX], vx = o[ENV_OBS_VX], vy = o[ENV_OBS_VY];
+ double want_vx = dx > 0 ? (dx > 100 ? 10 : dx / 10) : (dx < -100 ? -10 : dx / 10);
+
+ a[ENV_ACT_ROTATE] = -angle;
+ a[ENV_ACT_MAIN] = vy < -5 ? 1 : vy < 0 ? .4 : 0;
+ a[ENV_ACT_LEFT] = vx < want_vx ? .5 : 0;
+ a[ENV_ACT_RIGHT] = vx > want_vx ? .5 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+ struct Env *e;
+ unsigned int seed = time(NULL);
+ double limit = 120;
+ long steps = 1000, env_steps = 0, flights = 0, count[5] = {0};
+ int opt, n;
+ static struct Fault_Plan plan;
+ const char *plan_file = NULL, *faults = NULL;
+ struct timespec t0, t1;
+ double wall;
+
+ while ((opt = getopt(argc, argv, "s:t:k:f:F:")) != -1) {
+  if (opt == 's') seed = strtoul(optarg, NULL, 10);
+  else if (opt == 't') limit = atof(optarg);
+  else if (opt == 'k') steps = atol(optarg);
+  else if (opt == 'f') plan_file = optarg;
+  else if (opt == 'F') faults = optarg;
+  else break;
+ }
+ if (argc - optind < 2) {
+  fprintf(stderr, "Usage: Lander_Env [-s seed] [-t seconds] [-k steps] [-f plan] [-F faults] map envs\n");
+  return 1;
+ }
+ if ((plan_file && !Fault_Load(plan_file, &plan)) || (faults && !Fault_Parse(faults, &plan)))
+  return 1;
+ n = atoi(argv[optind + 1]);
+ e = Env_Create(argv[optind], n, seed, limit);
+ if (!e) {
+  fprintf(stderr, "Unable to set up %d environments on %s\n", n, argv[optind]);
+  return 1;
+ }
+ if (plan.n) Env_Faults(e, &plan);
+
+ clock_gettime(CLOCK_MONOTONIC, &t0);
+ for (long k = 0; k < steps; k++) {
+  for (int i = 0; i < n; i++) Policy(e->obs + i * ENV_OBS, e->act + i * ENV_ACT);
+  Env_Step(e);
+  env_steps += n;
+  for (int i = 0; i < n; i++)
+   if (e->done[i]) {
+    flights++;
+    count[e->s->status[i]]++;
+   }
+  Env_Reset(e, e->done);
+ }
+ clock_gettime(CLOCK_MONOTONIC, &t1);
+ wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+
+ printf("%d environments, seed %u, %ld steps\n", n, seed, steps);
+ printf("  %ld environment steps in %.2fs (%.0f per second)\n", env_steps, wall, env_steps / wall);
+ printf("  %ld flights finished\n", flights);
+ for (int k = 1; k <= 4; k++)
+  if (flights) printf("  %-10s %5ld (%.1f%%)\n", outcome[k], count[k], 100.0 * count[k] / flights);
+
+ Env_Free(e);
+ return 0;
+}
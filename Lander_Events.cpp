@@ -0,0 +1,117 @@
+/*
+	Event scheduling for the flight computer (see Lander_Events.h).
+
+	Events_Poll() is the only place that looks for changes. Each check
+	is a few loads and compares, so a tick with no events costs far
+	less than re-running the controllers' scans and sensor reads.
+*/
+
+#include <math.h>
+
+#include "Lander_Control.h"
+#include "Lander_Events.h"
+#include "Lander_Sensors.h"
+#include "Lander_Sonar.h"
+#include "Lander_State.h"
+
+CONTROLLER_STATE static struct {
+ int mask;
+ Event_Handler handler;
+} handlers[EV_MAX_HANDLERS];
+CONTROLLER_STATE static int n_handlers = 0;
+
+CONTROLLER_STATE static int (*watches[EV_MAX_WATCHES])(void);
+CONTROLLER_STATE static int watch_state = 0;	// bit i is the last value of watch i
+CONTROLLER_STATE static int n_watches = 0;
+
+CONTROLLER_STATE static unsigned int last_sonar = 0;
+CONTROLLER_STATE static int last_thrusters = -1;	// forces EV_FAILURE on the first poll
+CONTROLLER_STATE static long ticks = 0;
+
+CONTROLLER_STATE static int rotating = 0;
+CONTROLLER_STATE static double rotation_target;
+CONTROLLER_STATE static double rotation_tolerance;
+
+// Handlers run in the order they subscribed
+void Events_Subscribe(int mask, Event_Handler handler)
+{
+ if (n_handlers == EV_MAX_HANDLERS) return;
+ handlers[n_handlers].mask = mask;
+ handlers[n_handlers].handler = handler;
+ n_handlers++;
+}
+
+/*
+  Registers a condition checked once per tick, EV_THRESHOLD fires
+  whenever its value flips. Returns the id to pass to Events_Holds(),
+  or -1 if there are no free watch slots.
+*/
+int Events_Watch(int (*condition)(void))
+{
+ if (n_watches == EV_MAX_WATCHES) return -1;
+ watches[n_watches] = condition;
+ if (condition()) watch_state |= 1 << n_watches;
+ return n_watches++;
+}
+
+// Value of a watched condition as of the last poll
+int Events_Holds(int watch)
+{
+ return (watch_state >> watch) & 1;
+}
+
+// EV_ROTATED fires once Angle() is within tolerance degrees of target
+void Events_Rotation(double target, double tolerance)
+{
+ rotating = 1;
+ rotation_target = target;
+ rotation_tolerance = tolerance;
+}
+
+void Events_Cancel_Rotation(void)
+{
+ rotating = 0;
+}
+
+// Ticks polled so far, the current tick is Events_Ticks() - 1
+long Events_Ticks(void)
+{
+ return ticks;
+}
+
+int Events_Poll(void)
+{
+ int ev = 0, thrusters, state = 0;
+
+ // We're on the simulation's thread, so this is where sweeps get published
+ Sonar_Publish(ticks++ * T_STEP);
+ if (Sonar_Seq() != last_sonar) {
+  last_sonar = Sonar_Seq();
+  ev |= EV_SONAR;
+ }
+
+ thrusters = (MT_OK ? 1 : 0) | (LT_OK ? 2 : 0) | (RT_OK ? 4 : 0);
+ if (thrusters != last_thrusters) {
+  last_thrusters = thrusters;
+  ev |= EV_FAILURE;
+ }
+
+ if (rotating) {
+  double d = fmod(fabs(rotation_target - Sensed_Angle()), 360.0);
+  if (fmin(d, 360.0 - d) <= rotation_tolerance) {
+   rotating = 0;
+   ev |= EV_ROTATED;
+  }
+ }
+
+ for (int i = 0; i < n_watches; i++)
+  if (watches[i]()) state |= 1 << i;
+ if (state != watch_state) {
+  watch_state = state;
+  ev |= EV_THRESHOLD;
+ }
+
+ for (int i = 0; i < n_handlers; i++)
+  if (handlers[i].mask & ev) handlers[i].handler(ev);
+ return ev;
+}
@@ -0,0 +1,35 @@
+#ifndef _LANDER_EVENTS_H
+#define _LANDER_EVENTS_H
+
+/*
+  Event scheduling for the flight computer.
+
+  Lander_Control() and Safety_Override() are called every T_STEP, but
+  most of what they look at only changes now and then: sonar readings
+  change on a ping (every 50 ticks or so), thrusters fail once, and a
+  rotation takes many ticks to finish. Controller modules subscribe to
+  the events they care about, Events_Poll() works out once per tick
+  which of them happened and calls the subscribers, and the rest of the
+  tick runs a cheap fast path.
+*/
+
+// Event bits
+#define EV_SONAR	0x01	// a new sonar sweep landed in SONAR_DIST
+#define EV_ROTATED	0x02	// the rotation armed with Events_Rotation() is complete
+#define EV_FAILURE	0x04	// MT_OK, LT_OK or RT_OK changed
+#define EV_THRESHOLD	0x08	// a watched condition changed state
+
+#define EV_MAX_HANDLERS 8
+#define EV_MAX_WATCHES 8
+
+typedef void (*Event_Handler)(int events);
+
+void Events_Subscribe(int mask, Event_Handler handler);
+int Events_Watch(int (*condition)(void));
+int Events_Holds(int watch);
+void Events_Rotation(double target, double tolerance);
+void Events_Cancel_Rotation(void);
+long Events_Ticks(void);
+int Events_Poll(void);
+
+#endif
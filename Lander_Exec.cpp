@@ -0,0 +1,175 @@
+/*
+	Real-time executive for Lander_Swarm (see Lander_Exec.h).
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "Lander_Control.h"
+#include "Lander_Exec.h"
+#include "Lander_Perf.h"
+#include "Lander_Swarm.h"
+
+static double Now(void)
+{
+ struct timespec t;
+
+ clock_gettime(CLOCK_MONOTONIC, &t);
+ return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+struct Exec *Exec_Create(int n, double budget, int on_overrun, int paced)
+{
+ struct Exec *e = (struct Exec *) calloc(1, sizeof(struct Exec));
+
+ if (!e) return NULL;
+ e->budget = budget;
+ e->on_overrun = on_overrun;
+ e->paced = paced;
+ e->cpu = -1;
+ e->tasks = (long *) calloc(n, sizeof(long));
+ e->overruns = (long *) calloc(n, sizeof(long));
+ e->cost_sum = (double *) calloc(n, sizeof(double));
+ e->cost_max = (double *) calloc(n, sizeof(double));
+ e->control_max = (double *) calloc(n, sizeof(double));
+ e->safety_max = (double *) calloc(n, sizeof(double));
+ if (!e->tasks || !e->overruns || !e->cost_sum || !e->cost_max || !e->control_max || !e->safety_max) {
+  Exec_Free(e);
+  return NULL;
+ }
+ return e;
+}
+
+void Exec_Free(struct Exec *e)
+{
+ if (!e) return;
+ free(e->tasks);
+ free(e->overruns);
+ free(e->cost_sum);
+ free(e->cost_max);
+ free(e->control_max);
+ free(e->safety_max);
+ free(e);
+}
+
+/*
+  Lander i's control tasks for this tick, with its controller state
+  already swapped in (see Control() in Lander_Swarm.cpp).
+*/
+void Exec_Control(struct Swarm *s, int i)
+{
+ struct Exec *e = s->exec;
+ double mp = s->main_p[i], lp = s->left_p[i], rp = s->right_p[i], rot = s->rot[i];
+ double t0, t1, t2, t3, cost;
+
+ // Switching perf counters is the profiler's cost, not the task's
+ t0 = Now();
+ Lander_Control();
+ t1 = Now();
+ if (s->perf) Perf_Switch(s->perf, PERF_SAFETY);
+ t2 = Now();
+ Safety_Override();
+ t3 = Now();
+ if (s->perf) Perf_Switch(s->perf, PERF_CONTROL);
+ cost = (t1 - t0) + (t3 - t2);
+
+ e->tasks[i]++;
+ e->cost_sum[i] += cost;
+ if (cost > e->cost_max[i]) e->cost_max[i] = cost;
+ if (t1 - t0 > e->control_max[i]) e->control_max[i] = t1 - t0;
+ if (t3 - t2 > e->safety_max[i]) e->safety_max[i] = t3 - t2;
+ if (cost <= e->budget) return;
+
+ e->overruns[i]++;
+ if (e->on_overrun == EXEC_SAFE) mp = lp = rp = rot = 0;
+ // A failed thruster stays at 0 whatever the last command was
+ s->main_p[i] = (s->ok[i] & (1 << COMP_MAIN)) ? mp : 0;
+ s->left_p[i] = (s->ok[i] & (1 << COMP_LEFT)) ? lp : 0;
+ s->right_p[i] = (s->ok[i] & (1 << COMP_RIGHT)) ? rp : 0;
+ s->rot[i] = rot;
+}
+
+struct Run {
+ struct Swarm *s;
+ double limit;
+};
+
+static void *Executive(void *arg)
+{
+ struct Run *r = (struct Run *) arg;
+ struct Swarm *s = r->s;
+ struct Exec *e = s->exec;
+ double next = Now();
+
+ e->cpu = sched_getcpu();
+ for (;;) {
+  if (e->paced) {
+   struct timespec t;
+   double now;
+
+   t.tv_sec = (time_t) next;
+   t.tv_nsec = (long) ((next - t.tv_sec) * 1e9);
+   while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL) == EINTR);
+   now = Now();
+   e->releases++;
+   e->jitter_sum += now - next;
+   if (now - next > e->jitter_max) e->jitter_max = now - next;
+   if (now - next > T_STEP) {
+    e->late++;
+    next = now;		// lock step, the simulation waits for us
+   }
+   next += T_STEP;
+  }
+  if (!Swarm_Step(s) || s->time >= r->limit) break;
+ }
+ return NULL;
+}
+
+/*
+  Runs s until nobody's flying or limit seconds of simulated time,
+  on a thread pinned to the CPU we're on. Paced runs go at SCHED_FIFO
+  if allowed. Unpaced ones never sleep, and a real-time thread that
+  never sleeps gets stopped by the kernel's RT throttling for a good
+  fraction of every second, which would land on some unlucky task.
+*/
+void Exec_Run(struct Swarm *s, double limit)
+{
+ struct Exec *e = s->exec;
+ struct Run r = {s, limit};
+ struct sched_param sp;
+ pthread_attr_t attr;
+ pthread_t th;
+ cpu_set_t cpus;
+ int err, locked;
+
+ CPU_ZERO(&cpus);
+ CPU_SET(sched_getcpu(), &cpus);
+ pthread_attr_init(&attr);
+ pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+ if (e->paced) {
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+  sp.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+  pthread_attr_setschedparam(&attr, &sp);
+ }
+
+ locked = !mlockall(MCL_CURRENT | MCL_FUTURE);	// no page faults mid-tick, if we may
+ e->fifo = e->paced;
+ err = pthread_create(&th, &attr, Executive, &r);
+ if (err == EPERM) {
+  // Not allowed real-time priority, run at the normal one
+  e->fifo = 0;
+  pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+  err = pthread_create(&th, &attr, Executive, &r);
+ }
+ pthread_attr_destroy(&attr);
+ if (!err) pthread_join(th, NULL);
+ else fprintf(stderr, "Unable to start the executive thread: %s\n", strerror(err));
+ if (locked) munlockall();
+}
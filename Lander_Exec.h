@@ -0,0 +1,52 @@
+#ifndef _LANDER_EXEC_H
+#define _LANDER_EXEC_H
+
+/*
+  Real-time executive for Lander_Swarm.
+
+  The simulator waits for the controllers however long they take, so
+  nothing tells us whether they'd keep up on a flight computer that
+  has to put out a command every T_STEP. The executive runs the swarm
+  in lock step on its own thread pinned to one CPU, and treats each
+  lander's Lander_Control() plus Safety_Override() as a periodic task
+  with a budget.
+
+  A task that runs over its budget missed the actuators: whatever it
+  commanded that tick is thrown away and the lander gets either the
+  previous tick's commands (EXEC_HOLD) or thrusters off and no turning
+  (EXEC_SAFE). The controller's own state still moves on, as it would
+  on the real thing.
+
+  With paced set, each tick is released T_STEP after the last one by
+  the clock, at SCHED_FIFO priority when the system allows it
+  (otherwise the report says so), and the lateness of each release is
+  the jitter. Without it the swarm runs flat out at normal priority
+  and only the task costs count.
+*/
+
+#define EXEC_HOLD 0
+#define EXEC_SAFE 1
+
+struct Swarm;
+
+struct Exec {
+ double budget;		// seconds per control tick
+ int on_overrun;	// EXEC_HOLD or EXEC_SAFE
+ int paced;
+ int fifo, cpu;		// what the executive thread got, cpu -1 if not pinned
+
+ // Per lander
+ long *tasks, *overruns;
+ double *cost_sum, *cost_max;	// seconds, both controllers together
+ double *control_max, *safety_max;
+
+ long releases, late;	// late: released after the previous tick's deadline
+ double jitter_sum, jitter_max;
+};
+
+struct Exec *Exec_Create(int n, double budget, int on_overrun, int paced);
+void Exec_Free(struct Exec *e);
+void Exec_Control(struct Swarm *s, int i);
+void Exec_Run(struct Swarm *s, double limit);
+
+#endif
@@ -0,0 +1,332 @@
+/*
+	Failure space explorer.
+
+	Usage: Lander_Explore [-s seed] [-b landings] [-n batch] [-w width] [-q p]
+	                      [-S sets] [-O bins] [-R bins] [-T seconds] [-t seconds] map
+
+	e.g.   Lander_Explore hard.ppm
+	       Lander_Explore -b 50000 -S "1 2 3 1,2 1,3 2,3" easy.ppm
+
+	Splits the space of (failure set, failure onset time, starting x)
+	into cells and estimates how often the controllers fail to land in
+	each one. Every cell gets a few landings to start with, after that
+	landings go where they tell us the most: to cells whose failure
+	rate is still uncertain, and more so to cells next to a boundary
+	between cells that land and cells that crash. A cell is settled
+	once its 90% interval is narrower than -w (default .2). Neighbouring
+	cells that agree pool their landings for this, so the large regions
+	that always land or always crash stop costing landings after the
+	first pass.
+
+	-S lists the failure sets, each a comma separated list of
+	components (0 for none); by default none, each single component
+	and each pair of thrusters. Each component in a set dies at a
+	random time in the cell's onset window (-O bins over
+	0 to -T seconds, default 8 over 8s). -R splits the starting x range
+	into bins (default 8).
+
+	Failure sets are sampled far more often than they would come up
+	by chance; the overall estimate weighs each set by its odds if
+	every component failed independently with probability -q (default
+	.01) during a flight.
+
+	Landings run about -n (default 1000) at a time in one swarm (see
+	Lander_Swarm.h), -b (default 20000) is the total budget. A lander
+	still flying after -t seconds (default 60) counts as a failure.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <iostream>
+
+#include "Lander_Control.h"
+#include "Lander_Faults.h"
+#include "Lander_Rng.h"
+#include "Lander_Swarm.h"
+
+#define MAX_SETS 64
+#define MAX_BINS 32
+#define START_CHUNK 4		// landings per cell in the first pass
+#define CHUNK 8			// landings per cell per pass after that
+
+struct Cell {
+ int runs;
+ int fails;
+ struct Fault_Plan plan;
+};
+
+static int n_sets, sets[MAX_SETS];	// COMP_x bits
+static int onset_bins = 8, region_bins = 8;
+static double onset_max = 8;
+static struct Cell *cells;
+
+static struct Cell *Cell_At(int set, int onset, int region)
+{
+ return &cells[(set * onset_bins + onset) * region_bins + region];
+}
+
+#define Z 1.645			// 90% intervals
+#define AGREE .2		// neighbours this close in rate pool their landings
+
+static double Raw_Rate(const struct Cell *c)
+{
+ return c->runs ? (double) c->fails / c->runs : .5;
+}
+
+// Width of the Wilson score interval for k failures in n landings
+static double Wilson_Width(double k, double n)
+{
+ double p = k / n;
+
+ if (n <= 0) return 1;
+ return 2 * Z / (1 + Z * Z / n) * sqrt(p * (1 - p) / n + Z * Z / (4 * n * n));
+}
+
+/*
+  Interval width for a cell, counting the landings of its neighbours
+  (same failure set, next onset window or start region) whose failure
+  rate agrees with its own. Inside a region where everything lands
+  (or everything crashes) a cell is settled after a handful of its own
+  landings; cells on a boundary have to earn it themselves.
+*/
+static double Width(int set, int onset, int region)
+{
+ struct Cell *c = Cell_At(set, onset, region), *nb[4];
+ double k = c->fails, n = c->runs, p = Raw_Rate(c);
+ int m = 0;
+
+ if (!c->runs) return 1;
+ if (onset > 0) nb[m++] = Cell_At(set, onset - 1, region);
+ if (onset < onset_bins - 1) nb[m++] = Cell_At(set, onset + 1, region);
+ if (region > 0) nb[m++] = Cell_At(set, onset, region - 1);
+ if (region < region_bins - 1) nb[m++] = Cell_At(set, onset, region + 1);
+ for (int j = 0; j < m; j++)
+  if (nb[j]->runs && fabs(Raw_Rate(nb[j]) - p) < AGREE) {
+   k += nb[j]->fails;
+   n += nb[j]->runs;
+  }
+ return Wilson_Width(k, n);
+}
+
+// Landings a cell with failure rate p needs on its own to get under width w
+static int Needed(double p, double w)
+{
+ int n = 1;
+
+ while (n < 100000 && Wilson_Width(p * n, n) >= w) n++;
+ return n;
+}
+
+static int Parse_Sets(const char *spec)
+{
+ char *buf = strdup(spec), *tok, *save;
+
+ n_sets = 0;
+ for (tok = strtok_r(buf, " ", &save); tok && n_sets < MAX_SETS; tok = strtok_r(NULL, " ", &save)) {
+  int set = 0;
+  for (char *c = tok; *c; c++)
+   if (*c >= '1' && *c <= '9') set |= 1 << (*c - '0');
+  sets[n_sets++] = set;
+ }
+ free(buf);
+ return n_sets;
+}
+
+static void Set_Name(int set, char *name)
+{
+ static const char *names[] = {"", "main", "left", "right", "vx", "vy", "px", "py", "angle", "sonar"};
+
+ strcpy(name, set ? "" : "none");
+ for (int c = 1; c <= 9; c++)
+  if (set & (1 << c)) sprintf(name + strlen(name), "%s%s", name[0] ? "+" : "", names[c]);
+}
+
+/*
+  How much another round of landings in this cell is worth: its
+  interval width, doubled if a neighbour's rate is far from its own.
+*/
+static double Priority(int set, int onset, int region, double target)
+{
+ double w = Width(set, onset, region), p = Raw_Rate(Cell_At(set, onset, region));
+ int boundary = 0;
+
+ if (w < target) return 0;
+ for (int d = -1; d <= 1; d += 2) {
+  if (onset + d >= 0 && onset + d < onset_bins && fabs(Raw_Rate(Cell_At(set, onset + d, region)) - p) > .5) boundary = 1;
+  if (region + d >= 0 && region + d < region_bins && fabs(Raw_Rate(Cell_At(set, onset, region + d)) - p) > .5) boundary = 1;
+ }
+ return boundary ? 2 * w : w;
+}
+
+/*
+  Flies one swarm with want[k] landers in cell k, adds the outcomes to
+  the cells. Returns the number of landings flown.
+*/
+static int Fly(const char *map, const int *want, int n_cells, unsigned int seed, double limit)
+{
+ struct Swarm *s;
+ int n = 0, *cell_of;
+
+ for (int k = 0; k < n_cells; k++) n += want[k];
+ if (!n) return 0;
+ s = Swarm_Create(map, n, seed);
+ cell_of = (int *) malloc(n * sizeof(int));
+ if (!s || !cell_of) {
+  fprintf(stderr, "Unable to set up %d landers on %s\n", n, map);
+  exit(1);
+ }
+
+ for (int k = 0, i = 0; k < n_cells; k++)
+  for (int j = 0; j < want[k]; j++, i++) {
+   int region = k % region_bins;
+   double x0 = 50 + 925.0 * region / region_bins;
+
+   cell_of[i] = k;
+   s->x[i] = x0 + 925.0 / region_bins * Rng_Uniform(seed, i, 0, RNG_START, 5);
+   Swarm_Faults(s, i, &cells[k].plan);
+  }
+
+ while (Swarm_Step(s) && s->time < limit);
+ Swarm_Finish(s);
+
+ for (int i = 0; i < n; i++) {
+  cells[cell_of[i]].runs++;
+  if (s->status[i] != SWARM_LANDED) cells[cell_of[i]].fails++;
+ }
+ free(cell_of);
+ Swarm_Free(s);
+ return n;
+}
+
+static char Shade(const struct Cell *c)
+{
+ double p;
+
+ if (!c->runs) return ' ';
+ p = (double) c->fails / c->runs;
+ return p < .05 ? '.' : p < .25 ? ':' : p < .75 ? 'o' : p < .95 ? 'O' : '#';
+}
+
+int main(int argc, char *argv[])
+{
+ unsigned int seed = time(NULL);
+ int opt, budget = 20000, batch = 1000, n_cells, flown = 0, round = 0, *want;
+ double target = .2, q = .01, limit = 60;
+ const char *set_spec = "0 1 2 3 4 5 6 7 8 9 1,2 1,3 2,3";
+
+ while ((opt = getopt(argc, argv, "s:b:n:w:q:S:O:R:T:t:")) != -1) {
+  switch (opt) {
+   case 't': limit = atof(optarg); break;
+   case 's': seed = strtoul(optarg, NULL, 10); break;
+   case 'b': budget = atoi(optarg); break;
+   case 'n': batch = atoi(optarg); break;
+   case 'w': target = atof(optarg); break;
+   case 'q': q = atof(optarg); break;
+   case 'S': set_spec = optarg; break;
+   case 'O': onset_bins = atoi(optarg); break;
+   case 'R': region_bins = atoi(optarg); break;
+   case 'T': onset_max = atof(optarg); break;
+   default: optind = argc + 1;
+  }
+ }
+ if (optind != argc - 1 || !Parse_Sets(set_spec) || onset_bins < 1 || onset_bins > MAX_BINS ||
+     region_bins < 1 || region_bins > MAX_BINS || batch < 1) {
+  fprintf(stderr, "Usage: Lander_Explore [-s seed] [-b landings] [-n batch] [-w width] [-q p] [-S sets] [-O bins] [-R bins] [-T seconds] [-t seconds] map\n");
+  return 1;
+ }
+
+ n_cells = n_sets * onset_bins * region_bins;
+ cells = (struct Cell *) calloc(n_cells, sizeof(struct Cell));
+ want = (int *) calloc(n_cells, sizeof(int));
+ for (int set = 0; set < n_sets; set++)
+  for (int o = 0; o < onset_bins; o++) {
+   char script[256] = "";
+   double t0 = onset_max * o / onset_bins, t1 = onset_max * (o + 1) / onset_bins;
+   for (int c = 1; c <= 9; c++)
+    if (sets[set] & (1 << c)) sprintf(script + strlen(script), "%d dead at=%g..%g;", c, t0, t1);
+   for (int r = 0; r < region_bins; r++) Fault_Parse(script, &Cell_At(set, o, r)->plan);
+  }
+
+ std::cout.setstate(std::ios::badbit);	// controller chatter
+
+ // First pass, a few landings everywhere
+ for (int k = 0, queued = 0; k < n_cells; k++) {
+  want[k] = START_CHUNK;
+  queued += START_CHUNK;
+  if (queued >= batch || k == n_cells - 1) {
+   flown += Fly(argv[optind], want, n_cells, seed + round++, limit);
+   memset(want, 0, n_cells * sizeof(int));
+   queued = 0;
+  }
+ }
+
+ // Then wherever the answer is least certain
+ while (flown < budget) {
+  int n = 0;
+  double best;
+
+  do {
+   int pick = -1;
+   best = 0;
+   for (int set = 0; set < n_sets; set++)
+    for (int o = 0; o < onset_bins; o++)
+     for (int r = 0; r < region_bins; r++) {
+      int k = (set * onset_bins + o) * region_bins + r;
+      // Count what's already queued as if it had come back undecided
+      double pr = want[k] ? 0 : Priority(set, o, r, target);
+      if (pr > best) {
+       best = pr;
+       pick = k;
+      }
+     }
+   if (pick >= 0) {
+    want[pick] = CHUNK;
+    n += CHUNK;
+   }
+  } while (best > 0 && n < batch && flown + n < budget);
+  if (!n) break;
+  flown += Fly(argv[optind], want, n_cells, seed + round++, limit);
+  memset(want, 0, n_cells * sizeof(int));
+ }
+
+ // The map, one block per failure set: onset down, starting x across
+ printf("%d landings in %d rounds, %d cells, seed %u\n", flown, round, n_cells, seed);
+ printf("failure rate  . <5%%  : <25%%  o <75%%  O <95%%  # above\n\n");
+ double total = 0, total_var = 0, set_weight = 0;
+ int settled = 0, worst = 0;
+ for (int set = 0; set < n_sets; set++) {
+  char name[64];
+  int k = __builtin_popcount(sets[set]);
+  double w = pow(q, k) * pow(1 - q, 9 - k), sum = 0, var = 0;
+
+  Set_Name(sets[set], name);
+  for (int o = 0; o < onset_bins; o++) {
+   printf("%-18s%5.1fs |", o ? "" : name, onset_max * o / onset_bins);
+   for (int r = 0; r < region_bins; r++) {
+    struct Cell *c = Cell_At(set, o, r);
+    double p = Raw_Rate(c);
+    putchar(Shade(c));
+    sum += p;
+    var += p * (1 - p) / (c->runs + 1);
+    if (Width(set, o, r) < target) settled++;
+    if (Needed(p, target) > worst) worst = Needed(p, target);
+   }
+   printf("|\n");
+  }
+  sum /= onset_bins * region_bins;
+  var /= (double) onset_bins * region_bins * onset_bins * region_bins;
+  printf("%-18s%5.1f%% failed\n\n", "", 100 * sum);
+  total += w * sum;
+  total_var += w * w * var;
+  set_weight += w;
+ }
+ printf("%d of %d cells settled to +/-%.0f%%, a uniform sweep would need about %d landings for that\n",
+        settled, n_cells, 50 * target, worst * n_cells);
+ printf("failure rate over the listed sets, components failing with p=%g: %.2f%% +/- %.2f%%\n",
+        q, 100 * total / set_weight, 100 * 1.645 * sqrt(total_var) / set_weight);
+ return 0;
+}
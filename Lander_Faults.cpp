@@ -0,0 +1,251 @@
+/*
+	Failure injection for Lander_Swarm (see Lander_Faults.h).
+*/
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Lander_Control.h"
+#include "Lander_Faults.h"
+#include "Lander_Swarm.h"
+
+static const char *comp_names[] = {"", "main", "left", "right", "vx", "vy", "px", "py", "angle", "sonar"};
+static const char *type_names[] = {"dead", "intermittent", "stuck", "bias", "noisy"};
+
+static int Parse_Fault(char *line, struct Fault *f)
+{
+ char *tok, *save;
+
+ tok = strtok_r(line, " \t", &save);
+ f->comp = 0;
+ if (!strcmp(tok, "thruster")) f->comp = FAULT_ANY_THRUSTER;
+ else if (!strcmp(tok, "any")) f->comp = FAULT_ANY;
+ else if (atoi(tok) >= 1 && atoi(tok) <= 9) f->comp = atoi(tok);
+ else
+  for (int c = 1; c <= 9; c++)
+   if (!strcmp(tok, comp_names[c])) f->comp = c;
+ if (!f->comp) return 0;
+
+ tok = strtok_r(NULL, " \t", &save);
+ f->type = -1;
+ for (int t = 0; tok && t < 5; t++)
+  if (!strcmp(tok, type_names[t])) f->type = t;
+ if (f->type < 0) return 0;
+
+ f->when = FAULT_WHEN_TIME;
+ f->at = f->at2 = 0;
+ f->duration = 0;
+ f->p = 1;
+ f->value = NAN;
+ f->every = .1;
+ while ((tok = strtok_r(NULL, " \t", &save))) {
+  char *eq = strchr(tok, '='), *range;
+  if (!eq) return 0;
+  *eq++ = 0;
+  if (!strcmp(tok, "at")) {
+   f->at = f->at2 = atof(eq);
+   if ((range = strstr(eq, ".."))) f->at2 = atof(range + 2);
+  } else if (!strcmp(tok, "for")) f->duration = atof(eq);
+  else if (!strcmp(tok, "p")) f->p = atof(eq);
+  else if (!strcmp(tok, "value")) f->value = atof(eq);
+  else if (!strcmp(tok, "every")) f->every = atof(eq);
+  else if (!strcmp(tok, "when") && !strcmp(eq, "rotating")) f->when = FAULT_WHEN_ROTATING;
+  else return 0;
+ }
+ return f->at2 >= f->at && f->every > 0;
+}
+
+/*
+  Adds the faults in script to p. Returns 0 (p left as far as it got)
+  on a line it can't make sense of or if the plan is full.
+*/
+int Fault_Parse(const char *script, struct Fault_Plan *p)
+{
+ char *buf = strdup(script), *line, *save;
+ int ok = 1;
+
+ if (!buf) return 0;
+ for (line = strtok_r(buf, ";\n", &save); line && ok; line = strtok_r(NULL, ";\n", &save)) {
+  char *hash = strchr(line, '#'), text[256];
+  if (hash) *hash = 0;
+  if (!line[strspn(line, " \t\r")]) continue;
+  snprintf(text, sizeof(text), "%s", line);	// Parse_Fault() chops up line
+  if (p->n == FAULT_MAX || !Parse_Fault(line, &p->f[p->n])) {
+   fprintf(stderr, "Bad fault '%s'\n", text);
+   ok = 0;
+  } else p->n++;
+ }
+ free(buf);
+ return ok;
+}
+
+int Fault_Load(const char *filename, struct Fault_Plan *p)
+{
+ FILE *f = fopen(filename, "r");
+ char *script;
+ long len;
+ int ok;
+
+ if (!f) {
+  fprintf(stderr, "Unable to open fault plan %s\n", filename);
+  return 0;
+ }
+ fseek(f, 0, SEEK_END);
+ len = ftell(f);
+ rewind(f);
+ script = (char *) calloc(len + 1, 1);
+ ok = script && fread(script, 1, len, f) == (size_t) len && Fault_Parse(script, p);
+ free(script);
+ fclose(f);
+ return ok;
+}
+
+// Adds the faults the simulator's FAIL_MODE (and component list) would inject
+int Fault_Mode(int mode, int set, struct Fault_Plan *p)
+{
+ char script[256] = "";
+
+ if (mode == FAIL_THRUSTER) strcpy(script, "thruster dead at=0..4; thruster dead at=0..8");
+ else if (mode == FAIL_RANDOM) strcpy(script, "any dead at=0..4; any dead at=0..8");
+ else if (mode == FAIL_LIST)
+  for (int c = 1; c <= 9; c++)
+   if (set & (1 << c)) sprintf(script + strlen(script), "%d dead at=.5;", c);
+ return Fault_Parse(script, p);
+}
+
+static long Tick_After(double t)
+{
+ return (long) floor(t / T_STEP) + 1;	// the simulator fails things once SimTime > t
+}
+
+// Draws lander i's copy of its plan when its flight starts, onsets count from then
+void Faults_Start(struct Swarm *s, int i)
+{
+ const struct Fault_Plan *p = s->plan[i];
+ struct Fault_State *st = s->fault + i * FAULT_MAX;
+
+ s->fault_next[i] = LONG_MAX;
+ for (int k = 0; p && k < p->n; k++) {
+  const struct Fault *f = &p->f[k];
+  double t = f->at + (f->at2 - f->at) * Rng_Uniform(s->seed, i, s->launch[i], RNG_FAIL, 3 * k);
+
+  memset(&st[k], 0, sizeof(st[k]));
+  st[k].on = -1;
+  if (f->p >= 1 || Rng_Uniform(s->seed, i, s->launch[i], RNG_FAIL, 3 * k + 1) < f->p) {
+   st[k].on = s->launch[i] + Tick_After(t);
+   if (st[k].on < s->fault_next[i]) s->fault_next[i] = st[k].on;
+  }
+ }
+}
+
+static double *Thruster_Power(struct Swarm *s, int c)
+{
+ return c == COMP_MAIN ? s->main_p : c == COMP_LEFT ? s->left_p : s->right_p;
+}
+
+// What the component is doing right now, for stuck faults without a value
+static double Current(struct Swarm *s, int i, int c)
+{
+ switch (c) {
+  case COMP_MAIN: case COMP_LEFT: case COMP_RIGHT: return Thruster_Power(s, c)[i];
+  case COMP_VX: return s->vx[i];
+  case COMP_VY: return s->vy[i];
+  case COMP_PX: return s->x[i];
+  case COMP_PY: return s->y[i];
+  case COMP_ANGLE: return s->angle[i] * 180 / PI;
+ }
+ return 0;
+}
+
+// Rebuilds lander i's component flags and sensor faults from its active faults
+static void Apply(struct Swarm *s, int i)
+{
+ const struct Fault_Plan *p = s->plan[i];
+ const struct Fault_State *st = s->fault + i * FAULT_MAX;
+ unsigned char *fx = s->fx + i * FAULT_COMPS;
+ double *fv = s->fx_value + i * FAULT_COMPS;
+ int ok = COMP_ALL;
+
+ memset(fx, 0, FAULT_COMPS);
+ for (int k = 0; k < p->n; k++) {
+  const struct Fault *f = &p->f[k];
+  int c = st[k].comp;
+
+  if (!st[k].active) continue;
+  switch (f->type) {
+   case FAULT_DEAD: ok &= ~(1 << c); break;
+   case FAULT_INTERMITTENT: if (!st[k].up) ok &= ~(1 << c); break;
+   case FAULT_STUCK: fx[c] = FAULT_STUCK; fv[c] = st[k].value; break;
+   case FAULT_BIAS: fx[c] = FAULT_BIAS; fv[c] = isnan(f->value) ? 0 : f->value; break;
+   case FAULT_NOISY: fx[c] = FAULT_NOISY; fv[c] = isnan(f->value) ? 10 : f->value; break;
+  }
+ }
+ s->ok[i] = ok;
+
+ for (int c = COMP_MAIN; c <= COMP_RIGHT; c++) {
+  if (!(ok & (1 << c))) Thruster_Power(s, c)[i] = 0;
+  else if (fx[c] == FAULT_STUCK) Thruster_Power(s, c)[i] = fv[c];
+ }
+}
+
+static void Evaluate(struct Swarm *s, int i)
+{
+ const struct Fault_Plan *p = s->plan[i];
+ struct Fault_State *st = s->fault + i * FAULT_MAX;
+ long tick = s->tick, next = LONG_MAX;
+ int changed = 0;
+
+ for (int k = 0; k < p->n; k++) {
+  const struct Fault *f = &p->f[k];
+
+  if (st[k].on < 0) continue;
+  if (!st[k].active) {
+   if (tick < st[k].on) {
+    if (st[k].on < next) next = st[k].on;
+    continue;
+   }
+   if (f->when == FAULT_WHEN_ROTATING && s->rot[i] == 0) {
+    next = tick + 1;
+    continue;
+   }
+
+   // Onset
+   double r = Rng_Uniform(s->seed, i, tick, RNG_FAIL, 2 * k);
+   st[k].comp = f->comp == FAULT_ANY_THRUSTER ? (r < .5 ? COMP_MAIN : r < .75 ? COMP_LEFT : COMP_RIGHT) :
+                f->comp == FAULT_ANY ? 1 + (int) (8 * r) : f->comp;
+   if (st[k].comp > COMP_ANGLE && f->comp == FAULT_ANY) st[k].comp = COMP_ANGLE;
+   st[k].active = 1;
+   st[k].on = tick;
+   st[k].off = f->duration > 0 ? tick + (long) (f->duration / T_STEP) : LONG_MAX;
+   st[k].toggle = tick;
+   st[k].value = isnan(f->value) ? Current(s, i, st[k].comp) : f->value;
+   changed = 1;
+  }
+
+  if (tick >= st[k].off) {
+   st[k].active = 0;
+   st[k].on = -1;	// done for this flight
+   changed = 1;
+   continue;
+  }
+  if (f->type == FAULT_INTERMITTENT && tick >= st[k].toggle) {
+   st[k].up = Rng_Uniform(s->seed, i, tick, RNG_FAIL, 2 * k + 1) < (isnan(f->value) ? .5 : f->value);
+   st[k].toggle = tick + (long) ceil(f->every / T_STEP);
+   changed = 1;
+  }
+  if (st[k].off < next) next = st[k].off;
+  if (f->type == FAULT_INTERMITTENT && st[k].toggle < next) next = st[k].toggle;
+ }
+
+ if (changed) Apply(s, i);
+ s->fault_next[i] = next;
+}
+
+void Faults_Tick(struct Swarm *s)
+{
+ for (int i = 0; i < s->n; i++)
+  if (!s->status[i] && s->fault_next[i] <= s->tick) Evaluate(s, i);
+}
@@ -0,0 +1,100 @@
+#ifndef _LANDER_FAULTS_H
+#define _LANDER_FAULTS_H
+
+/*
+  Failure injection for Lander_Swarm.
+
+  The simulator's failure modes pick from a fixed menu at launch
+  (FAIL_MODE 1-3). A fault plan instead lists any number of faults,
+  each one
+
+    component type [at=T | at=T1..T2] [for=D] [p=P] [value=V] [every=S] [when=rotating]
+
+  separated by ';' or newlines ('#' starts a comment), e.g.
+
+    main dead at=2
+    left intermittent at=1..3 for=2 value=.3
+    vx bias at=0 value=5; angle noisy at=4 value=20
+    main dead at=1 when=rotating
+
+  component  main left right vx vy px py angle sonar (or 1-9, as on
+             the simulator's command line), 'thruster' for a random
+             thruster the way FAIL_MODE 1 picks one, 'any' for any of
+             1-8 like FAIL_MODE 2.
+  type       dead          component off
+             intermittent  up a fraction value (default .5) of the
+                           time, re-drawn every S seconds (default .1)
+             stuck         sensors keep reading value, thrusters keep
+                           pushing at power value; without a value it
+                           sticks at whatever it was at onset
+             bias          value added to every reading / power
+             noisy         noise value times (default 10) the usual
+  at         onset in seconds, a range is drawn uniformly per lander
+  for        duration in seconds, forever if left out
+  p          chance the fault happens at all in a flight (default 1)
+  when       rotating: onset is delayed until the lander is turning,
+             e.g. to catch a thruster dying mid-rotation
+
+  Plans are shared, what each lander gets out of one (onset times,
+  random components, whether it happens) is drawn from its own
+  Lander_Rng.h stream.
+
+  A lander's next fault event is kept with it, so evaluating faults
+  costs nothing on ticks where nothing happens.
+*/
+
+#define FAULT_MAX 16
+#define FAULT_COMPS 10	// per-lander component slots, 1-9 used
+
+// Fault types
+#define FAULT_DEAD 0
+#define FAULT_INTERMITTENT 1
+#define FAULT_STUCK 2
+#define FAULT_BIAS 3
+#define FAULT_NOISY 4
+
+// Components beyond the simulator's 1-9
+#define FAULT_ANY_THRUSTER -1
+#define FAULT_ANY -2
+
+// Onset conditions
+#define FAULT_WHEN_TIME 0
+#define FAULT_WHEN_ROTATING 1
+
+struct Fault {
+ int comp;
+ int type;
+ int when;
+ double at, at2;	// onset window (seconds)
+ double duration;	// <= 0 for the rest of the flight
+ double p;
+ double value;		// NAN for the type's default
+ double every;
+};
+
+struct Fault_Plan {
+ int n;
+ struct Fault f[FAULT_MAX];
+};
+
+// What one fault is doing to one lander
+struct Fault_State {
+ long on;		// tick it starts, -1 if it never does
+ long off;		// tick it ends
+ long toggle;		// next intermittent re-draw
+ int comp;		// resolved component
+ int active;
+ int up;		// intermittent component working
+ double value;		// stuck-at value captured at onset
+};
+
+struct Swarm;
+
+int Fault_Parse(const char *script, struct Fault_Plan *p);
+int Fault_Load(const char *filename, struct Fault_Plan *p);
+int Fault_Mode(int mode, int set, struct Fault_Plan *p);
+
+void Faults_Start(struct Swarm *s, int i);
+void Faults_Tick(struct Swarm *s);
+
+#endif
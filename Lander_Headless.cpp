@@ -0,0 +1,953 @@
+/*
+	The simulator without a display.
+
+	Lander_Control.o draws through OpenGL and GLUT, so it can't run
+	where there's no X server or GL driver. Linked with this file in
+	place of -lGL -lGLU -lglut (Lander_Control_Headless in the
+	Makefile) the simulator runs as it always does, but every GL, GLU
+	and GLUT call it makes lands here and is drawn in memory.
+
+	What's here is the part of fixed function GL the simulator uses:
+	modelview and projection matrices (translate, rotate, scale,
+	gluOrtho2D), textures (RGB, RGBA and BGRA, nearest or linear,
+	repeating), textured triangles and quads, and blending. Anything
+	else is accepted and ignored. The GLUT main loop calls the display
+	function for as long as it asks to be redisplayed; there's no
+	keyboard.
+
+	Triangles are queued until the frame is flushed, then rasterized a
+	TILE x TILE tile at a time, tiles shared out over a few threads.
+	Coverage follows GL's rules closely enough that the two halves of
+	a quad never both draw a pixel, so additive blending is right
+	along the diagonal. A triangle that maps texels onto pixels one to
+	one (the map) is copied straight out of the texture, and blending
+	works on whole spans at a time, with SIMD clones.
+
+	Set by environment, since the simulator owns the command line:
+
+	  LANDER_FRAMES=prefix   write every LANDER_FRAME_EVERY'th frame
+	                         (default 8) as prefix_NNNNNN.png
+	  LANDER_THREADS=n       rasterize with n threads (default one
+	                         per core)
+
+	The frame count and time spent drawing are printed on exit.
+*/
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Lander_PNG.h"
+
+#define TILE 64
+#define MAX_TEXTURES 64
+#define MAX_TRIS 1024		// queued per frame, more flushes early
+#define STACK_DEPTH 32
+#define MAX_THREADS 64
+
+#define SPAN_KERNEL __attribute__((target_clones("avx2", "default")))
+
+// The GL enums used here, so there's no need for GL headers
+#define GL_TRIANGLES 0x0004
+#define GL_TRIANGLE_STRIP 0x0005
+#define GL_TRIANGLE_FAN 0x0006
+#define GL_QUADS 0x0007
+#define GL_QUAD_STRIP 0x0008
+#define GL_POLYGON 0x0009
+#define GL_ZERO 0
+#define GL_ONE 1
+#define GL_SRC_COLOR 0x0300
+#define GL_ONE_MINUS_SRC_COLOR 0x0301
+#define GL_SRC_ALPHA 0x0302
+#define GL_ONE_MINUS_SRC_ALPHA 0x0303
+#define GL_DST_ALPHA 0x0304
+#define GL_ONE_MINUS_DST_ALPHA 0x0305
+#define GL_DST_COLOR 0x0306
+#define GL_ONE_MINUS_DST_COLOR 0x0307
+#define GL_COLOR_BUFFER_BIT 0x4000
+#define GL_BLEND 0x0BE2
+#define GL_TEXTURE_2D 0x0DE1
+#define GL_UNPACK_ALIGNMENT 0x0CF5
+#define GL_TEXTURE_MAG_FILTER 0x2800
+#define GL_TEXTURE_MIN_FILTER 0x2801
+#define GL_NEAREST 0x2600
+#define GL_MODELVIEW 0x1700
+#define GL_PROJECTION 0x1701
+#define GL_RGB 0x1907
+#define GL_RGBA 0x1908
+#define GL_BGRA 0x80E1
+#define GL_UNSIGNED_BYTE 0x1401
+
+struct Texture {
+ int w, h;
+ int linear;		// one filter for minifying and magnifying, the last one set
+ int pow2;		// both sides powers of two
+ unsigned char *rgba;
+};
+
+struct Vertex {
+ double x, y;		// window coordinates, y up
+ double u, v;
+};
+
+struct Tri {
+ struct Vertex v[3];
+ int tex;		// 0 if untextured
+ int blend;
+ unsigned int src, dst;	// blend factors
+};
+
+static int width = 640, height = 480;
+static unsigned char *fb;	// RGBA, bottom row first as in GL
+static int vp_x, vp_y, vp_w = 640, vp_h = 480;
+
+static double stack[2][STACK_DEPTH][16];	// column major, [0] modelview, [1] projection
+static int depth[2], mode;
+static int texturing, blending;
+static unsigned int blend_src = GL_ONE, blend_dst = GL_ZERO;
+static struct Texture textures[MAX_TEXTURES];
+static int bound, n_textures, unpack_align = 4;
+
+static int prim, n_prim;
+static struct Vertex prim_v[4], first_v;
+static double cur_u, cur_v;
+static struct Tri tris[MAX_TRIS];
+static int n_tris;
+
+static void (*display)(void);
+static void (*reshape)(int w, int h);
+static int redisplay;
+
+// Tile workers
+static int threads = 1;
+static pthread_t tid[MAX_THREADS];
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t go = PTHREAD_COND_INITIALIZER, done = PTHREAD_COND_INITIALIZER;
+static int generation, running, next_tile;
+
+// Frames
+static long frames;
+static const char *prefix;
+static int every = 8;
+static double draw_time;
+static unsigned char *rgb;
+
+static double Now(void)
+{
+ struct timespec t;
+
+ clock_gettime(CLOCK_MONOTONIC, &t);
+ return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static double *Top(void)
+{
+ return stack[mode][depth[mode]];
+}
+
+static void Identity(double *m)
+{
+ memset(m, 0, 16 * sizeof(double));
+ m[0] = m[5] = m[10] = m[15] = 1;
+}
+
+// The current matrix times b
+static void Multiply(const double *b)
+{
+ double *a = Top(), r[16];
+
+ for (int c = 0; c < 4; c++)
+  for (int row = 0; row < 4; row++)
+   r[c * 4 + row] = a[row] * b[c * 4] + a[4 + row] * b[c * 4 + 1] + a[8 + row] * b[c * 4 + 2] +
+                    a[12 + row] * b[c * 4 + 3];
+ memcpy(a, r, sizeof(r));
+}
+
+static void Transform(const double *m, const double *in, double *out)
+{
+ for (int row = 0; row < 4; row++)
+  out[row] = m[row] * in[0] + m[4 + row] * in[1] + m[8 + row] * in[2] + m[12 + row] * in[3];
+}
+
+/*
+  Spans. Each blends n pixels of src into dst, RGBA. The common cases
+  are plain loops the compiler vectorizes; anything else goes through
+  Factor() a component at a time.
+*/
+SPAN_KERNEL
+static void Span_Add(unsigned char *__restrict dst, const unsigned char *__restrict src, int n)
+{
+ for (int k = 0; k < 4 * n; k++) {
+  unsigned int s = dst[k] + src[k];
+
+  dst[k] = s > 255 ? 255 : s;
+ }
+}
+
+SPAN_KERNEL
+static void Span_Over(unsigned char *__restrict dst, const unsigned char *__restrict src, int n)
+{
+ for (int p = 0; p < n; p++) {
+  unsigned int a = src[4 * p + 3];
+
+  for (int c = 0; c < 4; c++)
+   dst[4 * p + c] = (src[4 * p + c] * a + dst[4 * p + c] * (255 - a) + 127) / 255;
+ }
+}
+
+static unsigned int Factor(unsigned int f, const unsigned char *s, const unsigned char *d, int c)
+{
+ switch (f) {
+ case GL_ZERO: return 0;
+ case GL_ONE: return 255;
+ case GL_SRC_COLOR: return s[c];
+ case GL_ONE_MINUS_SRC_COLOR: return 255 - s[c];
+ case GL_SRC_ALPHA: return s[3];
+ case GL_ONE_MINUS_SRC_ALPHA: return 255 - s[3];
+ case GL_DST_ALPHA: return d[3];
+ case GL_ONE_MINUS_DST_ALPHA: return 255 - d[3];
+ case GL_DST_COLOR: return d[c];
+ case GL_ONE_MINUS_DST_COLOR: return 255 - d[c];
+ }
+ return 0;
+}
+
+static void Span_Blend(const struct Tri *t, unsigned char *dst, const unsigned char *src, int n)
+{
+ if (!t->blend || (t->src == GL_ONE && t->dst == GL_ZERO)) memcpy(dst, src, 4 * n);
+ else if (t->src == GL_ONE && t->dst == GL_ONE) Span_Add(dst, src, n);
+ else if (t->src == GL_SRC_ALPHA && t->dst == GL_ONE_MINUS_SRC_ALPHA) Span_Over(dst, src, n);
+ else
+  for (int p = 0; p < n; p++, dst += 4, src += 4)
+   for (int c = 0; c < 4; c++) {
+    unsigned int v = (src[c] * Factor(t->src, src, dst, c) + dst[c] * Factor(t->dst, src, dst, c) + 127) / 255;
+
+    dst[c] = v > 255 ? 255 : v;
+   }
+}
+
+static const unsigned char *Texel(const struct Texture *tx, int x, int y)
+{
+ x %= tx->w;
+ y %= tx->h;
+ if (x < 0) x += tx->w;
+ if (y < 0) y += tx->h;
+ return tx->rgba + 4 * (y * tx->w + x);
+}
+
+static void Sample(const struct Texture *tx, double u, double v, unsigned char *out)
+{
+ double x = u * tx->w - .5, y = v * tx->h - .5, fx, fy;
+ int x0, y0;
+ const unsigned char *a, *b, *c, *d;
+
+ if (!tx->linear) {
+  memcpy(out, Texel(tx, (int) floor(u * tx->w), (int) floor(v * tx->h)), 4);
+  return;
+ }
+ x0 = (int) floor(x);
+ y0 = (int) floor(y);
+ fx = x - x0;
+ fy = y - y0;
+ a = Texel(tx, x0, y0);
+ b = Texel(tx, x0 + 1, y0);
+ c = Texel(tx, x0, y0 + 1);
+ d = Texel(tx, x0 + 1, y0 + 1);
+ for (int k = 0; k < 4; k++)
+  out[k] = (unsigned char) lrint((a[k] * (1 - fx) + b[k] * fx) * (1 - fy) + (c[k] * (1 - fx) + d[k] * fx) * fy);
+}
+
+// a + (b - a) * f / 256 for all four channels of two RGBA texels at once
+static inline unsigned int Lerp(unsigned int a, unsigned int b, unsigned int f)
+{
+ unsigned int rb = ((a & 0xff00ff) * (256 - f) + (b & 0xff00ff) * f) >> 8;
+ unsigned int ga = ((a >> 8) & 0xff00ff) * (256 - f) + ((b >> 8) & 0xff00ff) * f;
+
+ return (rb & 0xff00ff) | (ga & 0xff00ff00);
+}
+
+SPAN_KERNEL
+static void Row_Lerp(unsigned int *__restrict out, const unsigned int *a, const unsigned int *b, unsigned int f, int n)
+{
+ for (int k = 0; k < n; k++) out[k] = Lerp(a[k], b[k], f);
+}
+
+/*
+  n samples along a span starting at texel (x, y) and stepping by
+  (dx, dy), for a texture whose sides are powers of two (all the
+  simulator draws): 16.16 fixed point, wrapping by masking, 8 bit
+  filter weights. Texel (0, 0)'s centre is at (0, 0) here, as in
+  Sample() after its half texel shift.
+*/
+static void Span_Sample(const struct Texture *tx, double x, double y, double dx, double dy, int n,
+                        unsigned char *out)
+{
+ int mx = tx->w - 1, my = tx->h - 1, w = tx->w;
+ long fx = lrint(x * 65536), fy = lrint(y * 65536), sx = lrint(dx * 65536), sy = lrint(dy * 65536);
+ const unsigned int *t = (const unsigned int *) tx->rgba;
+ unsigned int *o = (unsigned int *) out;
+
+ if (!tx->linear) {
+  for (int k = 0; k < n; k++, fx += sx, fy += sy)
+   o[k] = t[(((fy + 32768) >> 16) & my) * w + (((fx + 32768) >> 16) & mx)];
+  return;
+ }
+ if (!sy && sx >= 0 && sx <= 4 << 16) {
+  /*
+    Not rotated (the map), and shrunk at most 4 times: the two rows
+    are blended once per texel column into v, then each sample only
+    has to blend two of those.
+  */
+  const unsigned int *r0 = t + ((fy >> 16) & my) * w, *r1 = t + (((fy >> 16) + 1) & my) * w;
+  unsigned int v[4 * TILE + 2], ay = (fy >> 8) & 255;
+  long c0 = fx >> 16;
+  int cols = (int) (((fx + sx * (n - 1)) >> 16) - c0 + 2);
+
+  fx -= c0 << 16;
+  if (c0 >= 0 && c0 + cols <= w) Row_Lerp(v, r0 + c0, r1 + c0, ay, cols);
+  else
+   for (int c = 0; c < cols; c++) v[c] = Lerp(r0[(c0 + c) & mx], r1[(c0 + c) & mx], ay);
+  for (int k = 0; k < n; k++, fx += sx) o[k] = Lerp(v[fx >> 16], v[(fx >> 16) + 1], (fx >> 8) & 255);
+  return;
+ }
+ for (int k = 0; k < n; k++, fx += sx, fy += sy) {
+  int x0 = (fx >> 16) & mx, y0 = (fy >> 16) & my, x1 = (x0 + 1) & mx, y1 = (y0 + 1) & my;
+  unsigned int ax = (fx >> 8) & 255, ay = (fy >> 8) & 255;
+
+  o[k] = Lerp(Lerp(t[y0 * w + x0], t[y0 * w + x1], ax), Lerp(t[y1 * w + x0], t[y1 * w + x1], ax), ay);
+ }
+}
+
+// Texture coordinates as planes over the window, u = du[0] * x + du[1] * y + du[2]
+struct Setup {
+ double e[3][3];	// edge functions, positive inside
+ int owns[3];		// whether the edge's own pixels are drawn (see Edges())
+ double du[3], dv[3];
+ int x0, y0, x1, y1;	// bounding box, pixels
+ int aligned;		// texels land on pixels one to one
+ int ax, ay, sy;	// and where: texel (x + ax, sy * y + ay)
+};
+
+/*
+  Edge functions for t, oriented so the inside is positive whichever
+  way round it was drawn. A pixel centre exactly on an edge belongs to
+  the triangle whose edge function rises to the right (or, for a
+  horizontal edge, upward); the neighbour sharing the edge has it
+  falling, so exactly one of the two draws it. Returns 0 for a
+  triangle with no area.
+*/
+static int Edges(const struct Tri *t, struct Setup *s)
+{
+ const struct Vertex *v = t->v;
+ double area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+ double sign = area < 0 ? -1 : 1;
+
+ if (area == 0 || isnan(area)) return 0;
+ for (int k = 0; k < 3; k++) {
+  const struct Vertex *a = &v[k], *b = &v[(k + 1) % 3];
+  double A = -(b->y - a->y) * sign, B = (b->x - a->x) * sign;
+
+  s->e[k][0] = A;
+  s->e[k][1] = B;
+  s->e[k][2] = -A * a->x - B * a->y;
+  s->owns[k] = A > 0 || (A == 0 && B > 0);
+ }
+
+ // Solve for the planes through the three vertices
+ for (int k = 0; k < 2; k++) {
+  double *d = k ? s->dv : s->du;
+  double q0 = k ? v[0].v : v[0].u, q1 = k ? v[1].v : v[1].u, q2 = k ? v[2].v : v[2].u;
+
+  d[0] = ((q1 - q0) * (v[2].y - v[0].y) - (q2 - q0) * (v[1].y - v[0].y)) / area;
+  d[1] = ((q2 - q0) * (v[1].x - v[0].x) - (q1 - q0) * (v[2].x - v[0].x)) / area;
+  d[2] = q0 - d[0] * v[0].x - d[1] * v[0].y;
+ }
+
+ s->x0 = (int) floor(fmin(v[0].x, fmin(v[1].x, v[2].x)));
+ s->y0 = (int) floor(fmin(v[0].y, fmin(v[1].y, v[2].y)));
+ s->x1 = (int) ceil(fmax(v[0].x, fmax(v[1].x, v[2].x)));
+ s->y1 = (int) ceil(fmax(v[0].y, fmax(v[1].y, v[2].y)));
+
+ s->aligned = 0;
+ if (t->tex) {
+  const struct Texture *tx = &textures[t->tex];
+  double ux = s->du[0] * tx->w, vy = s->dv[1] * tx->h;
+
+  if (fabs(ux - 1) < 1e-9 && fabs(s->du[1]) < 1e-12 && fabs(s->dv[0]) < 1e-12 && fabs(fabs(vy) - 1) < 1e-9) {
+   // Texel centres on pixel centres, where linear and nearest agree
+   double ax = (s->du[0] * .5 + s->du[2]) * tx->w - .5, ay = (s->dv[1] * .5 + s->dv[2]) * tx->h - .5;
+
+   if (fabs(ax - lrint(ax)) < 1e-6 && fabs(ay - lrint(ay)) < 1e-6) {
+    s->aligned = 1;
+    s->ax = (int) lrint(ax);
+    s->ay = (int) lrint(ay);
+    s->sy = vy > 0 ? 1 : -1;
+   }
+  }
+ }
+ return 1;
+}
+
+// Pixels [*lo, *hi] of row py inside all three edges
+static void Row_Span(const struct Setup *s, int py, int *lo, int *hi)
+{
+ double yc = py + .5;
+
+ for (int k = 0; k < 3; k++) {
+  double A = s->e[k][0], c = s->e[k][1] * yc + s->e[k][2], x;
+
+  if (A == 0) {
+   if (c < 0 || (c == 0 && !s->owns[k])) *hi = *lo - 1;
+   continue;
+  }
+  x = -c / A - .5;	// the pixel whose centre is on the edge
+  if (A > 0) {
+   int first = s->owns[k] ? (int) ceil(x) : (int) floor(x) + 1;
+
+   if (first > *lo) *lo = first;
+  } else {
+   int last = s->owns[k] ? (int) floor(x) : (int) ceil(x) - 1;
+
+   if (last < *hi) *hi = last;
+  }
+ }
+}
+
+static void Draw_Tri(const struct Tri *t, const struct Setup *s, int tx0, int ty0, int tx1, int ty1)
+{
+ unsigned char span[4 * TILE];
+ const struct Texture *tx = t->tex ? &textures[t->tex] : NULL;
+ int y0 = s->y0 > ty0 ? s->y0 : ty0, y1 = s->y1 < ty1 ? s->y1 : ty1;
+
+ for (int py = y0; py < y1; py++) {
+  int lo = s->x0 > tx0 ? s->x0 : tx0, hi = (s->x1 < tx1 ? s->x1 : tx1) - 1, n;
+  unsigned char *dst;
+
+  Row_Span(s, py, &lo, &hi);
+  if (hi < lo) continue;
+  n = hi - lo + 1;
+  dst = fb + 4 * (py * width + lo);
+  if (!tx) memset(span, 255, 4 * n);
+  else if (s->aligned && lo + s->ax >= 0 && hi + s->ax < tx->w) {
+   int ty = s->sy * py + s->ay;
+
+   ty %= tx->h;
+   if (ty < 0) ty += tx->h;
+   Span_Blend(t, dst, tx->rgba + 4 * (ty * tx->w + lo + s->ax), n);
+   continue;
+  } else {
+   double x = lo + .5, y = py + .5, u = s->du[0] * x + s->du[1] * y + s->du[2], v = s->dv[0] * x + s->dv[1] * y + s->dv[2];
+
+   if (tx->pow2) Span_Sample(tx, u * tx->w - .5, v * tx->h - .5, s->du[0] * tx->w, s->dv[0] * tx->h, n, span);
+   else
+    for (int k = 0; k < n; k++)
+     Sample(tx, u + s->du[0] * k, v + s->dv[0] * k, span + 4 * k);
+  }
+  Span_Blend(t, dst, span, n);
+ }
+}
+
+static struct Setup setups[MAX_TRIS];
+static int live[MAX_TRIS], n_live;
+
+static void Draw_Tile(int tile)
+{
+ int across = (width + TILE - 1) / TILE;
+ int tx0 = tile % across * TILE, ty0 = tile / across * TILE;
+ int tx1 = tx0 + TILE < width ? tx0 + TILE : width, ty1 = ty0 + TILE < height ? ty0 + TILE : height;
+
+ // In order, so blending comes out as it would on a GPU
+ for (int k = 0; k < n_live; k++) {
+  const struct Setup *s = &setups[live[k]];
+
+  if (s->x1 <= tx0 || s->x0 >= tx1 || s->y1 <= ty0 || s->y0 >= ty1) continue;
+  Draw_Tri(&tris[live[k]], s, tx0, ty0, tx1, ty1);
+ }
+}
+
+static int Tiles(void)
+{
+ return ((width + TILE - 1) / TILE) * ((height + TILE - 1) / TILE);
+}
+
+static void Take_Tiles(void)
+{
+ int k, n = Tiles();
+
+ while ((k = __atomic_fetch_add(&next_tile, 1, __ATOMIC_RELAXED)) < n) Draw_Tile(k);
+}
+
+static void *Worker(void *arg)
+{
+ int seen = 0;
+
+ (void) arg;
+ for (;;) {
+  pthread_mutex_lock(&lock);
+  while (generation == seen) pthread_cond_wait(&go, &lock);
+  seen = generation;
+  pthread_mutex_unlock(&lock);
+  Take_Tiles();
+  pthread_mutex_lock(&lock);
+  if (--running == 0) pthread_cond_signal(&done);
+  pthread_mutex_unlock(&lock);
+ }
+ return NULL;
+}
+
+// Rasterizes everything queued
+static void Flush(void)
+{
+ double t0 = Now();
+
+ n_live = 0;
+ for (int k = 0; k < n_tris; k++)
+  if (Edges(&tris[k], &setups[k])) live[n_live++] = k;
+ n_tris = 0;
+ if (!n_live) return;
+
+ next_tile = 0;
+ if (threads > 1) {
+  pthread_mutex_lock(&lock);
+  running = threads - 1;
+  generation++;
+  pthread_cond_broadcast(&go);
+  pthread_mutex_unlock(&lock);
+ }
+ Take_Tiles();
+ if (threads > 1) {
+  pthread_mutex_lock(&lock);
+  while (running) pthread_cond_wait(&done, &lock);
+  pthread_mutex_unlock(&lock);
+ }
+ draw_time += Now() - t0;
+}
+
+static void Queue(const struct Vertex *a, const struct Vertex *b, const struct Vertex *c)
+{
+ struct Tri *t;
+
+ if (n_tris == MAX_TRIS) Flush();
+ t = &tris[n_tris++];
+ t->v[0] = *a;
+ t->v[1] = *b;
+ t->v[2] = *c;
+ t->tex = texturing && bound > 0 && bound <= n_textures && textures[bound].rgba ? bound : 0;
+ t->blend = blending;
+ t->src = blend_src;
+ t->dst = blend_dst;
+}
+
+static void Report(void)
+{
+ if (frames)
+  fprintf(stderr, "Headless: %ld frames, drawing took %.3fms a frame (%.0f frames per second) on %d threads\n",
+          frames, draw_time / frames * 1000, frames / draw_time, threads);
+}
+
+static void Write_Frame(void)
+{
+ char name[1024];
+
+ if (!rgb && !(rgb = (unsigned char *) malloc(width * height * 3))) return;
+ for (int y = 0; y < height; y++) {
+  const unsigned char *s = fb + 4 * (height - 1 - y) * width;
+  unsigned char *d = rgb + 3 * y * width;
+
+  for (int x = 0; x < width; x++, s += 4, d += 3) {
+   d[0] = s[0];
+   d[1] = s[1];
+   d[2] = s[2];
+  }
+ }
+ snprintf(name, sizeof(name), "%s_%06ld.png", prefix, frames);
+ if (!PNG_Write(name, rgb, width, height)) perror(name);
+}
+
+/*
+  RGB to RGBA. The simulator re-uploads its whole map every frame, so
+  this reads each pixel as one (unaligned, little endian) word and sets
+  its alpha over the next pixel's red, except for the last, which could
+  be the end of the buffer.
+*/
+SPAN_KERNEL
+static void Expand_RGB(unsigned int *__restrict d, const unsigned char *__restrict s, int n)
+{
+ int x;
+
+ for (x = 0; x < n - 1; x++) {
+  unsigned int p;
+
+  memcpy(&p, s + 3 * x, 4);
+  d[x] = p | 0xff000000;
+ }
+ if (x < n) d[x] = s[3 * x] | s[3 * x + 1] << 8 | s[3 * x + 2] << 16 | 0xff000000;
+}
+
+// Copies w x h pixels of format into texture tx at (x0, y0)
+static void Upload(struct Texture *tx, int x0, int y0, int w, int h, unsigned int format, unsigned int type,
+                   const unsigned char *pixels)
+{
+ int bpp = format == GL_RGB ? 3 : 4, first = x0 < 0 ? -x0 : 0, last = x0 + w > tx->w ? tx->w - x0 : w;
+ size_t stride = (w * bpp + unpack_align - 1) / unpack_align * unpack_align;
+
+ if (!pixels || type != GL_UNSIGNED_BYTE || (format != GL_RGB && format != GL_RGBA && format != GL_BGRA)) return;
+ for (int y = 0; y < h; y++) {
+  const unsigned char *s = pixels + y * stride + first * bpp;
+  unsigned char *d;
+
+  if (y0 + y < 0 || y0 + y >= tx->h) continue;
+  d = tx->rgba + 4 * ((y0 + y) * tx->w + x0 + first);
+  if (format == GL_RGBA) memcpy(d, s, 4 * (last - first));
+  else if (format == GL_BGRA)
+   for (int x = 0; x < last - first; x++) {
+    d[4 * x] = s[4 * x + 2];
+    d[4 * x + 1] = s[4 * x + 1];
+    d[4 * x + 2] = s[4 * x];
+    d[4 * x + 3] = s[4 * x + 3];
+   }
+  else Expand_RGB((unsigned int *) d, s, last - first);
+ }
+}
+
+extern "C" {
+
+void glClear(unsigned int mask)
+{
+ if (mask & GL_COLOR_BUFFER_BIT) {
+  n_tris = 0;
+  memset(fb, 0, (size_t) width * height * 4);
+ }
+}
+
+void glViewport(int x, int y, int w, int h)
+{
+ vp_x = x;
+ vp_y = y;
+ vp_w = w;
+ vp_h = h;
+}
+
+void glMatrixMode(unsigned int m)
+{
+ mode = m == GL_PROJECTION;
+}
+
+void glLoadIdentity(void)
+{
+ Identity(Top());
+}
+
+void glPushMatrix(void)
+{
+ if (depth[mode] + 1 == STACK_DEPTH) return;
+ memcpy(stack[mode][depth[mode] + 1], Top(), 16 * sizeof(double));
+ depth[mode]++;
+}
+
+void glPopMatrix(void)
+{
+ if (depth[mode]) depth[mode]--;
+}
+
+void glTranslated(double x, double y, double z)
+{
+ double m[16];
+
+ Identity(m);
+ m[12] = x;
+ m[13] = y;
+ m[14] = z;
+ Multiply(m);
+}
+
+void glScaled(double x, double y, double z)
+{
+ double m[16];
+
+ Identity(m);
+ m[0] = x;
+ m[5] = y;
+ m[10] = z;
+ Multiply(m);
+}
+
+void glRotated(double angle, double x, double y, double z)
+{
+ double len = sqrt(x * x + y * y + z * z), s, c, m[16];
+
+ if (len == 0) return;
+ x /= len;
+ y /= len;
+ z /= len;
+ sincos(angle * M_PI / 180, &s, &c);
+ Identity(m);
+ m[0] = x * x * (1 - c) + c;
+ m[1] = y * x * (1 - c) + z * s;
+ m[2] = x * z * (1 - c) - y * s;
+ m[4] = x * y * (1 - c) - z * s;
+ m[5] = y * y * (1 - c) + c;
+ m[6] = y * z * (1 - c) + x * s;
+ m[8] = x * z * (1 - c) + y * s;
+ m[9] = y * z * (1 - c) - x * s;
+ m[10] = z * z * (1 - c) + c;
+ Multiply(m);
+}
+
+void gluOrtho2D(double left, double right, double bottom, double top)
+{
+ double m[16];
+
+ Identity(m);
+ m[0] = 2 / (right - left);
+ m[5] = 2 / (top - bottom);
+ m[10] = -1;
+ m[12] = -(right + left) / (right - left);
+ m[13] = -(top + bottom) / (top - bottom);
+ Multiply(m);
+}
+
+void glEnable(unsigned int cap)
+{
+ if (cap == GL_TEXTURE_2D) texturing = 1;
+ else if (cap == GL_BLEND) blending = 1;
+}
+
+void glDisable(unsigned int cap)
+{
+ if (cap == GL_TEXTURE_2D) texturing = 0;
+ else if (cap == GL_BLEND) blending = 0;
+}
+
+void glBlendFunc(unsigned int src, unsigned int dst)
+{
+ blend_src = src;
+ blend_dst = dst;
+}
+
+void glPixelStorei(unsigned int pname, int param)
+{
+ if (pname == GL_UNPACK_ALIGNMENT && (param == 1 || param == 2 || param == 4 || param == 8)) unpack_align = param;
+}
+
+void glGenTextures(int n, unsigned int *ids)
+{
+ for (int k = 0; k < n; k++) ids[k] = n_textures + 1 < MAX_TEXTURES ? ++n_textures : 0;
+}
+
+void glBindTexture(unsigned int target, unsigned int id)
+{
+ if (target == GL_TEXTURE_2D) bound = id;
+}
+
+void glTexParameteri(unsigned int target, unsigned int pname, int param)
+{
+ if (target != GL_TEXTURE_2D || bound <= 0 || bound >= MAX_TEXTURES) return;
+ if (pname == GL_TEXTURE_MAG_FILTER || pname == GL_TEXTURE_MIN_FILTER) textures[bound].linear = param != GL_NEAREST;
+}
+
+void glTexImage2D(unsigned int target, int level, int internal, int w, int h, int border, unsigned int format,
+                  unsigned int type, const void *pixels)
+{
+ struct Texture *tx;
+
+ (void) internal;
+ (void) border;
+ if (target != GL_TEXTURE_2D || level || bound <= 0 || bound >= MAX_TEXTURES || w < 1 || h < 1) return;
+ tx = &textures[bound];
+ free(tx->rgba);
+ tx->rgba = (unsigned char *) calloc((size_t) w * h, 4);
+ if (!tx->rgba) return;
+ tx->w = w;
+ tx->h = h;
+ tx->pow2 = !(w & (w - 1)) && !(h & (h - 1));
+ Upload(tx, 0, 0, w, h, format, type, (const unsigned char *) pixels);
+}
+
+void glTexSubImage2D(unsigned int target, int level, int x, int y, int w, int h, unsigned int format,
+                     unsigned int type, const void *pixels)
+{
+ if (target != GL_TEXTURE_2D || level || bound <= 0 || bound >= MAX_TEXTURES || !textures[bound].rgba) return;
+ Upload(&textures[bound], x, y, w, h, format, type, (const unsigned char *) pixels);
+}
+
+void glBegin(unsigned int m)
+{
+ prim = m;
+ n_prim = 0;
+}
+
+void glTexCoord2f(float u, float v)
+{
+ cur_u = u;
+ cur_v = v;
+}
+
+void glVertex3f(float x, float y, float z)
+{
+ double in[4] = {x, y, z, 1}, eye[4], clip[4];
+ struct Vertex w;
+
+ Transform(stack[0][depth[0]], in, eye);
+ Transform(stack[1][depth[1]], eye, clip);
+ w.x = vp_x + (clip[0] / clip[3] + 1) * vp_w / 2;
+ w.y = vp_y + (clip[1] / clip[3] + 1) * vp_h / 2;
+ w.u = cur_u;
+ w.v = cur_v;
+
+ switch (prim) {
+ case GL_TRIANGLES:
+  prim_v[n_prim++] = w;
+  if (n_prim == 3) {
+   Queue(&prim_v[0], &prim_v[1], &prim_v[2]);
+   n_prim = 0;
+  }
+  break;
+ case GL_QUADS:
+  prim_v[n_prim++] = w;
+  if (n_prim == 4) {
+   Queue(&prim_v[0], &prim_v[1], &prim_v[2]);
+   Queue(&prim_v[0], &prim_v[2], &prim_v[3]);
+   n_prim = 0;
+  }
+  break;
+ case GL_TRIANGLE_FAN:
+ case GL_POLYGON:
+  if (n_prim == 0) first_v = w;
+  else if (n_prim >= 2) Queue(&first_v, &prim_v[0], &w);
+  prim_v[0] = w;
+  n_prim++;
+  break;
+ case GL_TRIANGLE_STRIP:
+ case GL_QUAD_STRIP:
+  if (n_prim >= 2) Queue(&prim_v[0], &prim_v[1], &w);
+  prim_v[0] = prim_v[1];
+  prim_v[1] = w;
+  n_prim++;
+  break;
+ }
+}
+
+void glEnd(void)
+{
+ n_prim = 0;
+}
+
+void glFlush(void)
+{
+ Flush();
+}
+
+void glutInit(int *argc, char **argv)
+{
+ const char *s;
+
+ (void) argc;
+ (void) argv;
+ prefix = getenv("LANDER_FRAMES");
+ if ((s = getenv("LANDER_FRAME_EVERY")) && atoi(s) > 0) every = atoi(s);
+ threads = sysconf(_SC_NPROCESSORS_ONLN);
+ if ((s = getenv("LANDER_THREADS"))) threads = atoi(s);
+ if (threads < 1) threads = 1;
+ if (threads > MAX_THREADS) threads = MAX_THREADS;
+ for (int k = 0; k < 2; k++) Identity(stack[k][0]);
+ atexit(Report);
+}
+
+void glutInitDisplayMode(unsigned int m)
+{
+ (void) m;
+}
+
+void glutInitWindowPosition(int x, int y)
+{
+ (void) x;
+ (void) y;
+}
+
+void glutInitWindowSize(int w, int h)
+{
+ if (w > 0 && h > 0) {
+  width = w;
+  height = h;
+ }
+}
+
+int glutCreateWindow(const char *title)
+{
+ (void) title;
+ fb = (unsigned char *) calloc((size_t) width * height, 4);
+ if (!fb) {
+  fprintf(stderr, "Headless: out of memory for a %dx%d frame\n", width, height);
+  exit(1);
+ }
+ vp_w = width;
+ vp_h = height;
+ for (int k = 1; k < threads; k++)
+  if (pthread_create(&tid[k], NULL, Worker, NULL)) {
+   threads = k;
+   break;
+  }
+ return 1;
+}
+
+void glutSetWindow(int win)
+{
+ (void) win;
+}
+
+void glutDisplayFunc(void (*f)(void))
+{
+ display = f;
+}
+
+void glutReshapeFunc(void (*f)(int w, int h))
+{
+ reshape = f;
+}
+
+void glutKeyboardFunc(void (*f)(unsigned char key, int x, int y))
+{
+ (void) f;
+}
+
+void glutKeyboardUpFunc(void (*f)(unsigned char key, int x, int y))
+{
+ (void) f;
+}
+
+int glutGetModifiers(void)
+{
+ return 0;
+}
+
+void glutPostRedisplay(void)
+{
+ redisplay = 1;
+}
+
+void glutSwapBuffers(void)
+{
+ Flush();
+ if (prefix && frames % every == 0) Write_Frame();
+ frames++;
+}
+
+// Never returns, like GLUT's; the simulator exits when the flight is over
+void glutMainLoop(void)
+{
+ if (reshape) reshape(width, height);
+ redisplay = 1;
+ while (redisplay && display) {
+  redisplay = 0;
+  display();
+ }
+ fprintf(stderr, "Headless: the simulator stopped asking for frames\n");
+ exit(0);
+}
+
+}
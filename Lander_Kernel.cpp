@@ -0,0 +1,263 @@
+/*
+	Batched stepping for Lander_Swarm (see Lander_Kernel.h).
+
+	Same dynamics and rules as the single-lander code this replaced
+	in Lander_Swarm.cpp, the only differences are in the last bits of
+	the floating point sums.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "Lander_Control.h"
+#include "Lander_Faults.h"
+#include "Lander_Kernel.h"
+#include "Terrain_Tiles.h"
+
+/*
+  The clones must all produce the same bits, or a run would depend on
+  the machine it landed on, so no fused multiply-adds.
+*/
+#define KERNEL __attribute__((target_clones("avx512f", "avx2", "default"), optimize("fp-contract=off")))
+
+// round(), without the libm call, for the coordinates we deal with
+static inline int Nearest(double v)
+{
+ return v < 0 ? -(int) (.5 - v) : (int) (v + .5);
+}
+
+static inline int Bit(const unsigned long long rows[][MASK_WORDS], int x, int y)
+{
+ return (rows[y][x >> 6] >> (x & 63)) & 1;
+}
+
+// 1 if there's nothing at all in [x0, x1] x [y0, y1]
+static int Blocks_Empty(const struct Terrain_Mask *m, int x0, int y0, int x1, int y1)
+{
+ unsigned long long cols;
+
+ if (x0 < 0) x0 = 0;
+ if (y0 < 0) y0 = 0;
+ if (x1 >= SWARM_MAP_SIZE) x1 = SWARM_MAP_SIZE - 1;
+ if (y1 >= SWARM_MAP_SIZE) y1 = SWARM_MAP_SIZE - 1;
+ if (x0 > x1 || y0 > y1) return 1;
+
+ x0 >>= BLOCK_SHIFT;
+ x1 >>= BLOCK_SHIFT;
+ cols = (~0ULL >> (63 - (x1 - x0))) << x0;
+ for (int by = y0 >> BLOCK_SHIFT; by <= y1 >> BLOCK_SHIFT; by++)
+  if (m->blocks[by] & cols) return 0;
+ return 1;
+}
+
+// Blocks_Empty(), or the tiles' answer in a tiled world
+static int Nothing_In(const struct Swarm *s, int x0, int y0, int x1, int y1)
+{
+ return s->tiles ? Tile_Map_Empty(s->tiles, x0, y0, x1, y1) : Blocks_Empty(s->mask, x0, y0, x1, y1);
+}
+
+// Anything the sonar would hear at (x, y)
+static inline int Echo(const struct Swarm *s, int x, int y)
+{
+ if (s->tiles) return Tile_Map_Solid(s->tiles, x, y);
+ return x >= 0 && x < SWARM_MAP_SIZE && y >= 0 && y < SWARM_MAP_SIZE && Bit(s->mask->echo, x, y);
+}
+
+struct Terrain_Mask *Terrain_Mask_Build(const unsigned char *map)
+{
+ struct Terrain_Mask *m = (struct Terrain_Mask *) calloc(1, sizeof(struct Terrain_Mask));
+
+ if (!m) return NULL;
+ for (int y = 0; y < SWARM_MAP_SIZE; y++)
+  for (int x = 0; x < SWARM_MAP_SIZE; x++) {
+   const unsigned char *p = map + 3 * (y * SWARM_MAP_SIZE + x);
+   unsigned long long bit = 1ULL << (x & 63);
+
+   if (!(p[0] | p[1] | p[2])) continue;
+   m->echo[y][x >> 6] |= bit;
+   m->blocks[y >> BLOCK_SHIFT] |= 1ULL << (x >> BLOCK_SHIFT);
+   if (p[0] == 255 && !p[1] && !p[2]) m->pad[y][x >> 6] |= bit;
+   else if (p[0]) m->rock[y][x >> 6] |= bit;
+  }
+ return m;
+}
+
+// Same rule as the simulator, the centroid of the pure red pixels
+void Terrain_Platform(const unsigned char *map, double *plat_x, double *plat_y)
+{
+ double sx = 0, sy = 0;
+ long n = 0;
+
+ for (int y = 0; y < SWARM_MAP_SIZE; y++)
+  for (int x = 0; x < SWARM_MAP_SIZE; x++) {
+   const unsigned char *p = map + 3 * (y * SWARM_MAP_SIZE + x);
+   if (p[0] > 250 && p[1] < 10 && p[2] < 10) {
+    sx += x;
+    sy += y;
+    n++;
+   }
+  }
+ *plat_x = n ? sx / n : SWARM_MAP_SIZE / 2;
+ *plat_y = n ? sy / n : SWARM_MAP_SIZE / 2;
+}
+
+KERNEL
+static void Integrate(int n, const int *__restrict status,
+                      const double *__restrict sa, const double *__restrict ca,
+                      const double *__restrict mp, const double *__restrict lp, const double *__restrict rp,
+                      double *__restrict vx, double *__restrict vy, double *__restrict x, double *__restrict y)
+{
+ for (int i = 0; i < n; i++) {
+  double dt = status[i] ? 0 : T_STEP;	// landers that are done stay put
+  double ax = MT_ACCEL * mp[i] * sa[i] + (LT_ACCEL * lp[i] - RT_ACCEL * rp[i]) * ca[i];
+  double ay = MT_ACCEL * mp[i] * ca[i] + (RT_ACCEL * rp[i] - LT_ACCEL * lp[i]) * sa[i] - G_ACCEL;
+
+  vx[i] += ax * dt;
+  vy[i] += ay * dt;
+  x[i] += vx[i] * S_SCALE * dt;
+  y[i] -= vy[i] * S_SCALE * dt;
+ }
+}
+
+KERNEL
+static void Advance_Wavefronts(int n, const double *__restrict dir, double *__restrict dst)
+{
+ for (int k = 0; k < n; k++) {
+  double d = dst[k] + SONAR_RANGE * dir[k];
+  dst[k] = d < 0 ? 0 : d;
+ }
+}
+
+/*
+  Thruster powers are zeroed when a thruster fails (and commands to a
+  failed thruster are dropped), so the physics needn't look at the
+  component flags.
+*/
+void Kernel_Physics(struct Swarm *s)
+{
+ for (int i = 0; i < s->n; i++) {
+  double d;
+
+  if (s->rot[i] == 0 || s->status[i]) continue;
+  d = fmax(-MAX_ROT_RATE, fmin(s->rot[i], MAX_ROT_RATE));
+  s->angle[i] += d;
+  s->rot[i] -= d;
+  if (s->angle[i] < 0) s->angle[i] += 2 * PI;
+  s->angle[i] = fmod(s->angle[i], 2 * PI);
+  sincos(s->angle[i], &s->sin_a[i], &s->cos_a[i]);
+ }
+
+ Integrate(s->n, s->status, s->sin_a, s->cos_a, s->main_p, s->left_p, s->right_p,
+           s->vx, s->vy, s->x, s->y);
+ Advance_Wavefronts(s->n * SWARM_BEAMS, s->s_dir, s->s_dst);
+}
+
+// Sonar returns, the wavefront is an arc d/10 pixels either side of each beam
+static void Returns(struct Swarm *s, int i, const double *beam_sin, const double *beam_cos)
+{
+ double *dst = s->s_dst + i * SWARM_BEAMS, *dir = s->s_dir + i * SWARM_BEAMS;
+ int fx = s->fx[i * FAULT_COMPS + COMP_SONAR];
+ double fv = s->fx_value[i * FAULT_COMPS + COMP_SONAR];
+
+ for (int b = 0; b < SWARM_BEAMS; b++) {
+  double d = dst[b], cx, cy, ex, ey;
+  int kmax, hit = 0;
+
+  if (dir[b] == -1 || d / 10 <= 1) continue;
+  cx = Nearest((int) s->x[i] + beam_sin[b] * d);
+  cy = Nearest((int) s->y[i] - beam_cos[b] * d);
+  kmax = (int) ceil(d / 10) - 1;
+  ex = fabs(beam_cos[b]) * kmax + 1;
+  ey = fabs(beam_sin[b]) * kmax + 1;
+  if (Nothing_In(s, (int) (cx - ex), (int) (cy - ey), (int) (cx + ex), (int) (cy + ey))) continue;
+
+  for (int k = 1; k <= kmax && !hit; k++)
+   for (int side = -1; side <= 1 && !hit; side += 2) {
+    int px = Nearest(cx + side * beam_cos[b] * k), py = Nearest(cy + side * beam_sin[b] * k);
+    hit = Echo(s, px, py);
+   }
+  if (hit) {
+   double r = Rng_Uniform(s->seed, i, s->tick, RNG_SONAR, b) - .5;
+   s->sonar[i * SWARM_BEAMS + b] = d + d * r * (fx == FAULT_NOISY ? fv : 1) + (fx == FAULT_BIAS ? fv : 0);
+   dir[b] = -1;
+  }
+ }
+}
+
+void Kernel_Sonar(struct Swarm *s)
+{
+ static double beam_sin[SWARM_BEAMS], beam_cos[SWARM_BEAMS];
+
+ if (beam_cos[0] == 0)
+  for (int b = 0; b < SWARM_BEAMS; b++) {
+   beam_sin[b] = sin(b * 10 * PI / 180);
+   beam_cos[b] = cos(b * 10 * PI / 180);
+  }
+
+ // A stuck sonar keeps reporting its last sweep
+ for (int i = 0; i < s->n; i++)
+  if (!s->status[i] && (s->ok[i] & (1 << COMP_SONAR)) && s->fx[i * FAULT_COMPS + COMP_SONAR] != FAULT_STUCK)
+   Returns(s, i, beam_sin, beam_cos);
+}
+
+// Bits x to x + 63 of a mask row, off the map reads as empty
+static inline unsigned long long Row_Bits(const unsigned long long *row, int x)
+{
+ int w = x >> 6, sh = x & 63;
+ unsigned long long lo = w >= 0 && w < MASK_WORDS ? row[w] : 0;
+ unsigned long long hi = w + 1 >= 0 && w + 1 < MASK_WORDS ? row[w + 1] : 0;
+
+ return sh ? lo >> sh | hi << (64 - sh) : lo;
+}
+
+/*
+  More than 10 hull pixels on rock (or on the platform too fast or
+  too tilted) is a crash, touching the platform otherwise is a landing.
+  The hull is the upright sprite whatever the attitude, as in the
+  simulator, so each of its rows against the map is a shift, an AND
+  and a popcount for rock and again for the platform (the two masks
+  never share a pixel).
+*/
+KERNEL
+static int Collide(struct Swarm *s, int i)
+{
+ const struct Terrain_Mask *m = s->mask;
+ int x0 = (int) s->x[i] - 32, y0 = (int) s->y[i] - 32, hits = 0, pad = 0;
+ double a = s->angle[i];
+
+ if (x0 + 63 < 0 || x0 >= s->width || y0 + 63 < 0 || y0 >= s->height)
+  return SWARM_LOST;
+ if (Nothing_In(s, x0, y0, x0 + 63, y0 + 63)) return SWARM_FLYING;
+
+ for (int r = y0 < 0 ? -y0 : 0; r < 64 && y0 + r < s->height; r++) {
+  unsigned long long rock, plat;
+
+  if (!s->hull[r]) continue;
+  if (s->tiles) rock = Tile_Map_Row(s->tiles, x0, y0 + r, &plat);
+  else {
+   rock = Row_Bits(m->rock[y0 + r], x0);
+   plat = Row_Bits(m->pad[y0 + r], x0);
+  }
+  hits += __builtin_popcountll(rock & s->hull[r]);
+  pad += __builtin_popcountll(plat & s->hull[r]);
+ }
+ if (pad && !((a < 15 * PI / 180 || a > 345 * PI / 180) && fabs(s->vy[i]) < 10)) {
+  hits += pad;
+  pad = 0;
+ }
+ return hits > 10 ? SWARM_CRASHED : pad ? SWARM_LANDED : SWARM_FLYING;
+}
+
+// Updates everyone's status, returns how many are still flying
+int Kernel_Collide(struct Swarm *s)
+{
+ int flying = 0;
+
+ for (int i = 0; i < s->n; i++) {
+  if (s->status[i]) continue;
+  s->status[i] = Collide(s, i);
+  if (s->status[i]) s->end_tick[i] = s->tick;
+  else flying++;
+ }
+ return flying;
+}
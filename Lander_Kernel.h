@@ -0,0 +1,42 @@
+#ifndef _LANDER_KERNEL_H
+#define _LANDER_KERNEL_H
+
+/*
+  Batched stepping for Lander_Swarm.
+
+  Each call advances every lander in a swarm through one stage of a
+  tick. The physics runs down the per-lander arrays with no branches
+  and is compiled for AVX-512, AVX2 and plain x86-64, picked at load
+  time for the machine it runs on. Sin/cos of each lander's attitude
+  are cached and only recomputed while it turns.
+
+  Sonar and collision work on a bit mask of the map instead of the
+  RGB image, with a coarse map of which 16x16 blocks have anything in
+  them at all, so a lander in open sky (and most of a sonar wavefront)
+  is dismissed with a couple of word tests. A tiled world has no mask:
+  the same tests go to its tiles (Terrain_Tiles.h), whose summary
+  plays the part of the blocks, so only tiles near a lander or its
+  sonar are ever read.
+*/
+
+#include "Lander_Swarm.h"
+
+#define MASK_WORDS (SWARM_MAP_SIZE / 64)
+#define BLOCK_SIZE 16
+#define BLOCK_SHIFT 4
+
+struct Terrain_Mask {
+ unsigned long long echo[SWARM_MAP_SIZE][MASK_WORDS];	// anything the sonar sees (any channel lit)
+ unsigned long long rock[SWARM_MAP_SIZE][MASK_WORDS];	// red channel lit, except the platform
+ unsigned long long pad[SWARM_MAP_SIZE][MASK_WORDS];	// the platform, pure red
+ unsigned long long blocks[SWARM_MAP_SIZE / BLOCK_SIZE];	// bit x of word y set if block (x, y) has echo pixels
+};
+
+struct Terrain_Mask *Terrain_Mask_Build(const unsigned char *map);
+void Terrain_Platform(const unsigned char *map, double *plat_x, double *plat_y);
+
+void Kernel_Physics(struct Swarm *s);
+void Kernel_Sonar(struct Swarm *s);
+int Kernel_Collide(struct Swarm *s);
+
+#endif
@@ -0,0 +1,119 @@
+/*
+	Shared memory link (see Lander_Link.h), the parts both ends use.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Lander_Link.h"
+
+#define LINK_SPIN 2000		// polls before sleeping on the futex
+
+static size_t Link_Size(int n)
+{
+ return sizeof(struct Link) + n * sizeof(struct Link_Slot);
+}
+
+// The server's end, a new block for n landers under name ("/something")
+struct Link *Link_Create(const char *name, int n)
+{
+ int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+ struct Link *l;
+
+ if (fd < 0) return NULL;
+ if (ftruncate(fd, Link_Size(n))) {
+  close(fd);
+  shm_unlink(name);
+  return NULL;
+ }
+ l = (struct Link *) mmap(NULL, Link_Size(n), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+ close(fd);
+ if (l == MAP_FAILED) {
+  shm_unlink(name);
+  return NULL;
+ }
+ memset(l, 0, Link_Size(n));
+ l->version = LINK_VERSION;
+ l->slot_size = sizeof(struct Link_Slot);
+ l->n = n;
+ l->server_pid = getpid();
+ __atomic_store_n(&l->magic, LINK_MAGIC, __ATOMIC_RELEASE);
+ return l;
+}
+
+// The client's end, NULL if there's no such link or it was built differently
+struct Link *Link_Open(const char *name)
+{
+ int fd = shm_open(name, O_RDWR, 0);
+ struct Link head, *l;
+
+ if (fd < 0) return NULL;
+ if (pread(fd, &head, sizeof(head), 0) != sizeof(head) || head.magic != LINK_MAGIC ||
+     head.version != LINK_VERSION || head.slot_size != sizeof(struct Link_Slot)) {
+  close(fd);
+  return NULL;
+ }
+ l = (struct Link *) mmap(NULL, Link_Size(head.n), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+ close(fd);
+ if (l == MAP_FAILED) return NULL;
+ l->client_pid = getpid();
+ return l;
+}
+
+void Link_Close(struct Link *l, const char *name, int unlink)
+{
+ munmap(l, Link_Size(l->n));
+ if (unlink) shm_unlink(name);
+}
+
+/*
+  Waits for *word to move on from seen, for up to timeout seconds
+  (forever if timeout <= 0). Returns 1 if it did, 0 on timing out.
+*/
+int Link_Wait(unsigned int *word, unsigned int seen, double timeout)
+{
+ struct timespec now, end, left;
+
+ for (int k = 0; k < LINK_SPIN; k++) {
+  if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != seen) return 1;
+  __builtin_ia32_pause();
+ }
+ clock_gettime(CLOCK_MONOTONIC, &end);
+ end.tv_sec += (time_t) floor(timeout);
+ end.tv_nsec += (long) ((timeout - floor(timeout)) * 1e9);
+ if (end.tv_nsec >= 1000000000) {
+  end.tv_sec++;
+  end.tv_nsec -= 1000000000;
+ }
+ while (__atomic_load_n(word, __ATOMIC_ACQUIRE) == seen) {
+  if (timeout > 0) {
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   left.tv_sec = end.tv_sec - now.tv_sec;
+   left.tv_nsec = end.tv_nsec - now.tv_nsec;
+   if (left.tv_nsec < 0) {
+    left.tv_sec--;
+    left.tv_nsec += 1000000000;
+   }
+   if (left.tv_sec < 0) return 0;
+  }
+  if (syscall(SYS_futex, word, FUTEX_WAIT, seen, timeout > 0 ? &left : NULL, NULL, 0) && errno != EAGAIN &&
+      errno != EINTR && errno != ETIMEDOUT)
+   return 0;
+ }
+ return 1;
+}
+
+// Publishes a new value of *word and wakes whoever is waiting on it
+void Link_Post(unsigned int *word, unsigned int value)
+{
+ __atomic_store_n(word, value, __ATOMIC_RELEASE);
+ syscall(SYS_futex, word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
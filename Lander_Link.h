@@ -0,0 +1,108 @@
+#ifndef _LANDER_LINK_H
+#define _LANDER_LINK_H
+
+/*
+  Shared memory link between a swarm and controllers in another process.
+
+  The controllers have to be linked in with whatever simulates the
+  lander, so one that crashes or hangs takes the whole batch run down
+  with it. Over a link the swarm (Lander_Swarm -R) keeps the physics,
+  noise and failures and the controllers run in a client process
+  (Lander_Client) with the controller API answered from shared memory.
+
+  The link is one shm_open() block per run: a header and a slot per
+  lander with what its sensors read this tick and the commands that
+  came back. Every tick the server fills in the slots of the landers
+  still flying, bumps tick_seq and wakes the client. The client runs
+  each lander's controllers against its slot, then sets done_seq to
+  tick_seq and wakes the server, which applies the commands through
+  the simulator's actuator model. Both sides spin for a little while
+  before sleeping on the futex, so a client that keeps up never
+  sleeps at all. Nothing is serialized, the slots are plain structs
+  and both sides have to be built from the same Lander_Link.h (the
+  header's version and slot size are checked on attach).
+
+  The exchange is in lock step, so the "ring" is one slot deep: the
+  server never writes a slot the client might be reading. A client
+  that doesn't answer within the server's timeout, or dies, is cut
+  off: its landers keep their last commands for the rest of the
+  flight, the way a controller that overruns under EXEC_HOLD does.
+
+  client_pid is the client's to write, so the server reads it once,
+  when the client attaches, and never signals anything it didn't
+  start itself.
+
+  Each sensor is read once per tick on the server. Reading it again
+  in the same tick returns the same value rather than new noise. For
+  Sensors_Oversample() the server also sends LINK_SAMPLES more
+  readings of every sensor, which the client's Sensor_Mean() averages,
+  so an oversampling controller sees the same noise it would in the
+  swarm as long as a tick asks for no more than LINK_SAMPLES readings
+  of a sensor. Past that the readings go round again.
+*/
+
+#include "Lander_Sensors.h"
+
+#define LINK_MAGIC 0x4c4e4b31	// "LNK1"
+#define LINK_VERSION 2
+#define LINK_SAMPLES 16		// readings of each sensor a tick for oversampling
+
+// Commands set this tick (Link_Cmd.set)
+#define LINK_MAIN 1
+#define LINK_LEFT 2
+#define LINK_RIGHT 4
+#define LINK_ROTATE 8
+
+struct Link_Obs {
+ int flying;
+ int mt_ok, lt_ok, rt_ok;
+ double px, py, vx, vy, angle, range;
+ double sonar[36];
+ double plat_x, plat_y;
+ double samples[SENSORS][LINK_SAMPLES];	// fresh readings, for Sensor_Mean()
+};
+
+struct Link_Cmd {
+ int set;
+ double main, left, right, rotate;
+};
+
+struct Link_Slot {
+ struct Link_Obs obs;
+ struct Link_Cmd cmd;
+} __attribute__((aligned(64)));
+
+struct Link {
+ unsigned int magic, version, slot_size;
+ int n;
+ int server_pid, client_pid;
+ unsigned int tick_seq __attribute__((aligned(64)));	// futex word, bumped by the server
+ unsigned int done_seq __attribute__((aligned(64)));	// futex word, the client's answer
+ int finished;		// set by the server when the run is over
+ struct Link_Slot slot[] __attribute__((aligned(64)));
+};
+
+// The server's bookkeeping
+struct Link_Server {
+ struct Link *link;
+ double timeout;	// seconds to wait for the client each tick
+ int child;		// pid of the client if we started it
+ int client;		// pid the client attached as, read once (see Link_Serve())
+ int lost;		// client cut off
+ long lost_tick;
+ long exchanges;
+ double wait_sum, wait_max;	// seconds from posting a tick to the answer
+};
+
+struct Swarm;
+
+struct Link *Link_Create(const char *name, int n);
+struct Link *Link_Open(const char *name);
+void Link_Close(struct Link *l, const char *name, int unlink);
+int Link_Wait(unsigned int *word, unsigned int seen, double timeout);
+void Link_Post(unsigned int *word, unsigned int value);
+
+int Link_Serve(struct Swarm *s, struct Link_Server *srv, const char *name, const char *client);
+void Link_Finish(struct Link_Server *srv);
+
+#endif
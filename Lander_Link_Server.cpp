@@ -0,0 +1,148 @@
+/*
+	The swarm's end of a link (see Lander_Link.h): fills in the
+	slots, waits for the client, and flies its commands.
+*/
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Lander_Control.h"
+#include "Lander_Link.h"
+#include "Lander_Sensors.h"
+#include "Lander_Swarm.h"
+
+static double Now(void)
+{
+ struct timespec t;
+
+ clock_gettime(CLOCK_MONOTONIC, &t);
+ return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Still there? A client we started is reaped, anyone else is asked with kill(0)
+static int Client_Alive(struct Link_Server *srv)
+{
+ if (srv->child > 0) {
+  if (waitpid(srv->child, NULL, WNOHANG) != srv->child) return 1;
+  srv->child = 0;
+  return 0;
+ }
+ return srv->client > 0 && kill(srv->client, 0) == 0;
+}
+
+static void Cut_Off(struct Link_Server *srv, struct Swarm *s, const char *why)
+{
+ srv->lost = 1;
+ srv->lost_tick = s->tick;
+ fprintf(stderr, "Link: client %s at %.3fs, flying on without it\n", why, s->time);
+}
+
+static void Exchange(struct Swarm *s)
+{
+ struct Link_Server *srv = (struct Link_Server *) s->pilot_arg;
+ struct Link *l = srv->link;
+ unsigned int seq;
+ double t0, waited;
+
+ if (srv->lost) return;
+ for (int i = 0; i < s->n; i++) {
+  struct Link_Slot *slot = &l->slot[i];
+  struct Link_Obs *o = &slot->obs;
+
+  o->flying = !s->status[i];
+  slot->cmd.set = 0;
+  if (!o->flying) continue;
+  Swarm_Select(s, i);
+  o->mt_ok = MT_OK;
+  o->lt_ok = LT_OK;
+  o->rt_ok = RT_OK;
+  o->px = Position_X();
+  o->py = Position_Y();
+  o->vx = Velocity_X();
+  o->vy = Velocity_Y();
+  o->angle = Angle();
+  o->range = RangeDist();
+  memcpy(o->sonar, SONAR_DIST, sizeof(o->sonar));
+  o->plat_x = PLAT_X;
+  o->plat_y = PLAT_Y;
+  for (int k = 0; k < SENSORS; k++)
+   for (int j = 0; j < LINK_SAMPLES; j++) o->samples[k][j] = Sensor_Mean(k, 1);
+ }
+
+ seq = l->tick_seq + 1;
+ t0 = Now();
+ Link_Post(&l->tick_seq, seq);
+ if (!Link_Wait(&l->done_seq, seq - 1, srv->timeout)) Cut_Off(srv, s, Client_Alive(srv) ? "timed out" : "died");
+ waited = Now() - t0;
+ srv->exchanges++;
+ srv->wait_sum += waited;
+ if (waited > srv->wait_max) srv->wait_max = waited;
+}
+
+// Lander i's share of what came back, through the simulator's actuator model
+static void Pilot(struct Swarm *s, int i)
+{
+ struct Link_Server *srv = (struct Link_Server *) s->pilot_arg;
+ const struct Link_Cmd *c = &srv->link->slot[i].cmd;
+
+ if (srv->lost) return;
+ if (c->set & LINK_MAIN) Main_Thruster(c->main);
+ if (c->set & LINK_LEFT) Left_Thruster(c->left);
+ if (c->set & LINK_RIGHT) Right_Thruster(c->right);
+ if (c->set & LINK_ROTATE) Rotate(c->rotate);
+}
+
+/*
+  Has swarm s flown by whoever attaches to srv->link. If client isn't
+  NULL it's started with the link's name as its argument, otherwise
+  this waits up to srv->timeout for someone to attach. Returns 0 if
+  nobody did, or if someone other than the client we started did.
+*/
+int Link_Serve(struct Swarm *s, struct Link_Server *srv, const char *name, const char *client)
+{
+ double give_up = Now() + (srv->timeout > 0 ? srv->timeout : 1e9);
+
+ if (client) {
+  srv->child = fork();
+  if (srv->child == 0) {
+   execl(client, client, name, (char *) NULL);
+   perror(client);
+   _exit(1);
+  }
+ }
+ while (!__atomic_load_n(&srv->link->client_pid, __ATOMIC_ACQUIRE)) {
+  if (Now() > give_up || (srv->child > 0 && waitpid(srv->child, NULL, WNOHANG) == srv->child)) return 0;
+  usleep(1000);
+ }
+ srv->client = __atomic_load_n(&srv->link->client_pid, __ATOMIC_ACQUIRE);
+ if (srv->child > 0 && srv->client != srv->child) {
+  fprintf(stderr, "Link: process %d attached instead of %d, giving up\n", srv->client, srv->child);
+  kill(srv->child, SIGKILL);
+  waitpid(srv->child, NULL, 0);
+  srv->child = 0;
+  return 0;
+ }
+ s->pilot = Pilot;
+ s->exchange = Exchange;
+ s->pilot_arg = srv;
+ return 1;
+}
+
+/*
+  Tells the client the run is over and waits for one it started, which
+  is killed if it stopped answering. One that attached by itself is
+  only told.
+*/
+void Link_Finish(struct Link_Server *srv)
+{
+ srv->link->finished = 1;
+ Link_Post(&srv->link->tick_seq, srv->link->tick_seq + 1);
+ if (srv->child > 0) {
+  if (srv->lost) kill(srv->child, SIGKILL);
+  waitpid(srv->child, NULL, 0);
+ }
+}
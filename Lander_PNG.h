@@ -0,0 +1,11 @@
+#ifndef _LANDER_PNG_H
+#define _LANDER_PNG_H
+
+/*
+  PNG output for the offline renderers (Lander_Render, the headless
+  simulator). Images are 8 bit RGB, top row first.
+*/
+
+int PNG_Write(const char *filename, const unsigned char *rgb, int width, int height);
+
+#endif
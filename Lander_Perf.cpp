@@ -0,0 +1,169 @@
+/*
+	Hardware counter profiles (see Lander_Perf.h).
+*/
+
+#include <linux/perf_event.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "Lander_Perf.h"
+
+static const struct {
+ unsigned int type;
+ unsigned long long config;
+} events[PERF_EVENTS] = {
+ {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+ {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+ {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+ {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+ {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+ {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+ {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+ {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+
+static const char *parts[PERF_PARTS] = {"control", "safety", "physics", "sonar", "collide", "trace", "draw",
+                                        "output", "other"};
+
+static int Event_Open(int e, int group)
+{
+ struct perf_event_attr a;
+
+ memset(&a, 0, sizeof(a));
+ a.size = sizeof(a);
+ a.type = events[e].type;
+ a.config = events[e].config;
+ a.exclude_kernel = 1;
+ a.exclude_hv = 1;
+ a.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+ return (int) syscall(SYS_perf_event_open, &a, 0, -1, group, 0);
+}
+
+/*
+  The cycle counter leads the group if there is one, otherwise the
+  task clock does. Events the machine doesn't have are left out.
+*/
+static void Open(struct Perf *p)
+{
+ p->n = 0;
+ p->lead = -1;
+ for (int e = 0; e < PERF_EVENTS; e++) {
+  p->fd[e] = Event_Open(e, p->lead < 0 ? -1 : p->fd[p->lead]);
+  if (p->fd[e] < 0) continue;
+  if (p->lead < 0) p->lead = e;
+  p->slot[e] = p->n++;
+ }
+ p->hardware = p->lead == PERF_CYCLES;
+ p->state = p->lead < 0 ? -1 : 1;
+ memset(p->last, 0, sizeof(p->last));
+}
+
+// Charges what was counted since the last read to the part running
+static void Read(struct Perf *p)
+{
+ unsigned long long buf[3 + PERF_EVENTS];
+
+ if (read(p->fd[p->lead], buf, sizeof(buf)) < (ssize_t) ((3 + p->n) * sizeof(buf[0]))) return;
+ for (int e = 0; e < PERF_EVENTS; e++) {
+  if (p->fd[e] < 0) continue;
+  p->count[p->part][e] += buf[3 + p->slot[e]] - p->last[e];
+  p->last[e] = buf[3 + p->slot[e]];
+ }
+ p->enabled += buf[1] - p->last[PERF_EVENTS];
+ p->running += buf[2] - p->last[PERF_EVENTS + 1];
+ p->last[PERF_EVENTS] = buf[1];
+ p->last[PERF_EVENTS + 1] = buf[2];
+}
+
+struct Perf *Perf_Create(void)
+{
+ struct Perf *p = (struct Perf *) calloc(1, sizeof(struct Perf));
+
+ if (!p) return NULL;
+ for (int e = 0; e < PERF_EVENTS; e++) p->fd[e] = -1;
+ p->part = PERF_OTHER;
+ return p;
+}
+
+// From now on, what the calling thread does is part
+void Perf_Switch(struct Perf *p, int part)
+{
+ if (p->state == 1) Read(p);
+ else if (!p->state) Open(p);
+ p->part = part;
+ p->calls[part]++;
+}
+
+void Perf_Stop(struct Perf *p)
+{
+ if (p->state != 1) return;
+ Read(p);
+ for (int e = 0; e < PERF_EVENTS; e++)
+  if (p->fd[e] >= 0) {
+   close(p->fd[e]);
+   p->fd[e] = -1;
+  }
+ p->state = 0;
+}
+
+// Adds one thread's counts into another's
+void Perf_Add(struct Perf *to, const struct Perf *from)
+{
+ for (int k = 0; k < PERF_PARTS; k++) {
+  to->calls[k] += from->calls[k];
+  for (int e = 0; e < PERF_EVENTS; e++) to->count[k][e] += from->count[k][e];
+ }
+ to->enabled += from->enabled;
+ to->running += from->running;
+ to->hardware |= from->hardware;
+ if (from->state == -1 && !to->hardware) to->state = -1;
+}
+
+// num / den * scale in a column width wide, or a dash if there's nothing to show
+static void Ratio(FILE *f, int have, double num, double den, double scale, int width, int digits, const char *unit)
+{
+ if (have && den > 0) fprintf(f, " %*.*f%s", width, digits, num / den * scale, unit);
+ else fprintf(f, " %*s%*s", width, "-", (int) strlen(unit), "");
+}
+
+void Perf_Report(const struct Perf *p, FILE *f)
+{
+ unsigned long long total = 0;
+ int hw = p->hardware;
+
+ for (int k = 0; k < PERF_PARTS; k++) total += p->count[k][PERF_TASK_CLOCK];
+ if (p->state == -1 && !total) {
+  fprintf(f, "profile: no counters, perf_event_open() isn't allowed here (see perf_event_paranoid)\n");
+  return;
+ }
+ if (!hw) fprintf(f, "profile: no hardware counters here, task clock and page faults only\n");
+ else
+  fprintf(f, "profile: hardware counters, counting %.1f%% of the time\n",
+          p->enabled ? 100.0 * p->running / p->enabled : 0);
+ fprintf(f, "  %-8s %10s %9s %6s %9s %11s %5s %11s %10s %11s %7s\n", "part", "calls", "cpu ms", "share",
+         "ns/call", "cycles/call", "IPC", "cache miss", "LLC/call", "branch miss", "faults");
+ for (int k = 0; k < PERF_PARTS; k++) {
+  const unsigned long long *c = p->count[k];
+  double calls = p->calls[k];
+
+  if (!calls) continue;
+  fprintf(f, "  %-8s %10ld %9.1f", parts[k], p->calls[k], c[PERF_TASK_CLOCK] / 1e6);
+  Ratio(f, 1, c[PERF_TASK_CLOCK], total, 100, 5, 1, "%");
+  Ratio(f, 1, c[PERF_TASK_CLOCK], calls, 1, 9, 0, "");
+  Ratio(f, hw, c[PERF_CYCLES], calls, 1, 11, 0, "");
+  Ratio(f, hw, c[PERF_INSTRUCTIONS], c[PERF_CYCLES], 1, 5, 2, "");
+  Ratio(f, hw, c[PERF_CACHE_MISSES], c[PERF_CACHE_REFS], 100, 10, 1, "%");
+  Ratio(f, hw, c[PERF_CACHE_MISSES], calls, 1, 10, 2, "");
+  Ratio(f, hw, c[PERF_BRANCH_MISSES], c[PERF_BRANCHES], 100, 10, 2, "%");
+  fprintf(f, " %7llu\n", c[PERF_PAGE_FAULTS]);
+ }
+}
+
+void Perf_Free(struct Perf *p)
+{
+ if (!p) return;
+ Perf_Stop(p);
+ free(p);
+}
@@ -0,0 +1,76 @@
+#ifndef _LANDER_PERF_H
+#define _LANDER_PERF_H
+
+/*
+  Hardware counter profiles, by part of the work (Lander_Swarm -P,
+  Lander_Render -P).
+
+  Wall clock time says a tick is slow, not why. This counts cycles,
+  instructions, cache references and misses, branches and branch
+  misses with perf_event_open(), plus the task clock and page faults,
+  and charges them to whichever part of the work was running: the
+  controllers, the safety override, physics, sonar, collision, trace
+  recording, or drawing and output in the renderer.
+
+  The program marks each change of part with Perf_Switch(), which
+  reads the whole group of counters in one go and charges what they
+  counted since the last switch to the part that was running, so
+  there's a system call per switch and nothing in between. Counters
+  are per thread, opened by the first switch on the thread doing the
+  work (the executive's, with -x) and closed by Perf_Stop(). The
+  hardware counters only count user space, so the switches don't show
+  in them, but the task clock has a few hundred nanoseconds of system
+  call in every switch, which matters for parts entered per lander.
+
+  Where the machine has no hardware counters (most virtual machines)
+  the group is just the task clock and page faults, and the report
+  says so. If the hardware group didn't fit on the PMU all the time
+  (other profilers, the NMI watchdog) the report says what share of
+  the time it was counting.
+*/
+
+#include <stdio.h>
+
+// Parts of the work
+#define PERF_CONTROL 0		// Lander_Control(), or whatever flies in its place
+#define PERF_SAFETY 1		// Safety_Override()
+#define PERF_PHYSICS 2
+#define PERF_SONAR 3
+#define PERF_COLLIDE 4
+#define PERF_TRACE 5		// recording frames (Lander_Trace.h)
+#define PERF_DRAW 6		// Lander_Render drawing frames
+#define PERF_OUTPUT 7		// and writing them out
+#define PERF_OTHER 8		// anything between
+#define PERF_PARTS 9
+
+// Events
+#define PERF_CYCLES 0
+#define PERF_INSTRUCTIONS 1
+#define PERF_CACHE_REFS 2
+#define PERF_CACHE_MISSES 3
+#define PERF_BRANCHES 4
+#define PERF_BRANCH_MISSES 5
+#define PERF_TASK_CLOCK 6	// nanoseconds
+#define PERF_PAGE_FAULTS 7
+#define PERF_EVENTS 8
+
+struct Perf {
+ int fd[PERF_EVENTS];		// -1 while closed, or if the event isn't there
+ int slot[PERF_EVENTS];		// place in a group read
+ int lead, n, part;
+ int state;			// 0 closed, 1 open, -1 perf_event_open() refused
+ int hardware;			// the hardware events opened
+ unsigned long long last[PERF_EVENTS + 2];	// at the last read, then time enabled and running
+ unsigned long long enabled, running;	// over everything counted
+ unsigned long long count[PERF_PARTS][PERF_EVENTS];
+ long calls[PERF_PARTS];
+};
+
+struct Perf *Perf_Create(void);
+void Perf_Switch(struct Perf *p, int part);
+void Perf_Stop(struct Perf *p);
+void Perf_Add(struct Perf *to, const struct Perf *from);
+void Perf_Report(const struct Perf *p, FILE *f);
+void Perf_Free(struct Perf *p);
+
+#endif
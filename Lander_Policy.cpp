@@ -0,0 +1,212 @@
+/*
+	Learned policy inference (see Lander_Policy.h).
+
+	The network isn't CONTROLLER_STATE on purpose: it's read only
+	once loaded, and every lander in a swarm flies the same one.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Lander_Env.h"
+#include "Lander_Policy.h"
+
+/*
+  Weights are stored transposed, a column of out weights per input,
+  padded with zeros to a multiple of COL_ALIGN, so a layer is a run of
+  y += x[k] * column k over all the outputs at once. That vectorizes
+  across the outputs without reassociating any sums, and without the
+  horizontal adds a dot product per output would need.
+*/
+#define COL_ALIGN 16
+
+#define POLICY_KERNEL __attribute__((target_clones("avx512f", "avx2", "default")))
+
+struct Layer {
+ int in, out, pad;		// pad is out rounded up to COL_ALIGN
+ int type, act;
+ const float *w;		// POLICY_F32, in columns of pad
+ const signed char *q;		// POLICY_I8, in columns of pad
+ const float *scale;		// POLICY_I8, per output
+ const float *b;
+};
+
+static struct Layer net[POLICY_MAX_LAYERS];
+static int layers = 0;
+static char *block;		// all the weights
+
+POLICY_KERNEL
+static void Dense_F32(const struct Layer *l, const float *__restrict x, float *__restrict y)
+{
+ const int pad = l->pad;
+
+ for (int r = 0; r < pad; r++) y[r] = 0;
+ for (int k = 0; k < l->in; k++) {
+  const float *__restrict w = l->w + (size_t) k * pad;
+  float xk = x[k];
+
+  for (int r = 0; r < pad; r++) y[r] += w[r] * xk;
+ }
+ for (int r = 0; r < l->out; r++) y[r] += l->b[r];
+}
+
+POLICY_KERNEL
+static void Dense_I8(const struct Layer *l, const float *__restrict x, float *__restrict y)
+{
+ const int pad = l->pad;
+
+ for (int r = 0; r < pad; r++) y[r] = 0;
+ for (int k = 0; k < l->in; k++) {
+  const signed char *__restrict q = l->q + (size_t) k * pad;
+  float xk = x[k];
+
+  for (int r = 0; r < pad; r++) y[r] += q[r] * xk;
+ }
+ for (int r = 0; r < l->out; r++) y[r] = y[r] * l->scale[r] + l->b[r];
+}
+
+/*
+  tanh() as a 13/6 rational function, within 3e-7 of tanhf() and
+  flat past +/-7.9. tanhf() itself doesn't vectorize, and took longer
+  than the matrix products it followed.
+*/
+POLICY_KERNEL
+static void Tanh(int n, float *__restrict y)
+{
+ for (int r = 0; r < n; r++) {
+  float x = y[r] < -7.905311f ? -7.905311f : y[r] > 7.905311f ? 7.905311f : y[r], x2 = x * x;
+  float p = -2.76076847742355e-16f;
+  float q = 1.19825839466702e-06f;
+
+  p = p * x2 + 2.00018790482477e-13f;
+  p = p * x2 + -8.60467152213735e-11f;
+  p = p * x2 + 5.12229709037114e-08f;
+  p = p * x2 + 1.48572235717979e-05f;
+  p = p * x2 + 6.37261928875436e-04f;
+  p = p * x2 + 4.89352455891786e-03f;
+  q = q * x2 + 1.18534705686654e-04f;
+  q = q * x2 + 2.26843463243900e-03f;
+  q = q * x2 + 4.89352518554385e-03f;
+  y[r] = x * p / q;
+ }
+}
+
+static size_t Round_Up(size_t n, size_t to)
+{
+ return (n + to - 1) / to * to;
+}
+
+static int Read(FILE *f, void *p, size_t size, size_t n)
+{
+ return fread(p, size, n, f) == n;
+}
+
+/*
+  Loads a policy file. Returns 1 on success, 0 (with a message) if the
+  file is missing or malformed, in which case no policy is loaded.
+*/
+int Policy_Load(const char *filename)
+{
+ FILE *f = fopen(filename, "rb");
+ char magic[4];
+ int n, dims[POLICY_MAX_LAYERS][4];
+ size_t size = 0, at = 0;
+
+ layers = 0;
+ if (!f) {
+  fprintf(stderr, "Policy_Load(): can't open %s\n", filename);
+  return 0;
+ }
+ if (!Read(f, magic, 1, 4) || memcmp(magic, "LPOL", 4) || !Read(f, &n, sizeof(n), 1) ||
+     n < 1 || n > POLICY_MAX_LAYERS)
+  goto bad;
+
+ // First pass for the sizes, then back for the weights
+ for (int k = 0; k < n; k++) {
+  int *d = dims[k];
+  long skip;
+
+  if (!Read(f, d, sizeof(int), 4) || d[0] < 1 || d[1] < 1 || d[0] > POLICY_MAX_WIDTH || d[1] > POLICY_MAX_WIDTH ||
+      (d[2] != POLICY_F32 && d[2] != POLICY_I8) || d[3] < POLICY_LINEAR || d[3] > POLICY_TANH ||
+      (k && d[0] != dims[k - 1][1]))
+   goto bad;
+  skip = d[2] == POLICY_F32 ? ((long) d[1] * d[0] + d[1]) * 4 : (long) d[1] * 8 + (long) d[1] * d[0];
+  if (fseek(f, skip, SEEK_CUR)) goto bad;
+  size += Round_Up((size_t) d[0] * Round_Up(d[1], COL_ALIGN) * (d[2] == POLICY_F32 ? 4 : 1), 64);
+  size += 2 * Round_Up((size_t) d[1] * 4, 64);
+ }
+ if (dims[0][0] != ENV_OBS || dims[n - 1][1] != ENV_ACT) goto bad;
+
+ free(block);
+ block = (char *) aligned_alloc(64, size);
+ if (!block) goto bad;
+ memset(block, 0, size);
+ fseek(f, 8, SEEK_SET);
+ for (int k = 0; k < n; k++) {
+  struct Layer *l = &net[k];
+  int item = dims[k][2] == POLICY_F32 ? 4 : 1;
+  char *w;
+  float *scale = NULL, *b;
+
+  fseek(f, 4 * sizeof(int), SEEK_CUR);
+  l->in = dims[k][0];
+  l->out = dims[k][1];
+  l->pad = Round_Up(l->out, COL_ALIGN);
+  l->type = dims[k][2];
+  l->act = dims[k][3];
+  w = block + at;
+  at += Round_Up((size_t) l->in * l->pad * item, 64);
+  if (l->type == POLICY_I8) {
+   scale = (float *) (block + at);
+   if (!Read(f, scale, 4, l->out)) goto bad;
+  }
+  at += Round_Up((size_t) l->out * 4, 64);
+  b = (float *) (block + at);
+  at += Round_Up((size_t) l->out * 4, 64);
+  // Rows in the file, columns here
+  for (int r = 0; r < l->out; r++)
+   for (int c = 0; c < l->in; c++)
+    if (!Read(f, w + ((size_t) c * l->pad + r) * item, item, 1)) goto bad;
+  if (!Read(f, b, 4, l->out)) goto bad;
+  l->w = (const float *) w;
+  l->q = (const signed char *) w;
+  l->scale = scale;
+  l->b = b;
+ }
+ fclose(f);
+ layers = n;
+ return 1;
+
+bad:
+ fprintf(stderr, "Policy_Load(): %s isn't a policy for this lander\n", filename);
+ fclose(f);
+ return 0;
+}
+
+int Policy_Loaded(void)
+{
+ return layers > 0;
+}
+
+// out[ENV_ACT] for in[ENV_OBS], nothing allocated
+void Policy_Eval(const float *in, float *out)
+{
+ float buf[2][POLICY_MAX_WIDTH] __attribute__((aligned(64)));
+ float *x = buf[0], *y = buf[1], *t;
+
+ memcpy(x, in, ENV_OBS * sizeof(float));
+ for (int k = 0; k < layers; k++) {
+  const struct Layer *l = &net[k];
+
+  if (l->type == POLICY_F32) Dense_F32(l, x, y);
+  else Dense_I8(l, x, y);
+  if (l->act == POLICY_RELU)
+   for (int r = 0; r < l->out; r++) y[r] = y[r] > 0 ? y[r] : 0;
+  else if (l->act == POLICY_TANH)
+   Tanh(l->out, y);
+  t = x; x = y; y = t;
+ }
+ memcpy(out, x, ENV_ACT * sizeof(float));
+}
@@ -0,0 +1,51 @@
+#ifndef _LANDER_POLICY_H
+#define _LANDER_POLICY_H
+
+/*
+  Learned policy inference.
+
+  A policy is a small stack of dense layers trained offline against
+  Lander_Env.h. Its input is that environment's observation (ENV_OBS
+  floats in the ENV_OBS_ order) and its output the action (ENV_ACT
+  floats: main, left and right thruster power and a Rotate() angle),
+  so whatever was trained there flies here unchanged. Any input
+  scaling has to be folded into the first layer.
+
+  When the LANDER_POLICY environment variable names a policy file,
+  Lander_Control() flies the policy instead of the hand-written
+  controllers; Safety_Override() still runs after it, and overrides
+  it, as it would the controllers. The file is loaded once on the
+  first tick and shared by every lander in a swarm.
+
+  File format, little endian, no padding:
+
+    char magic[4]            "LPOL"
+    int32 layers             1 - POLICY_MAX_LAYERS
+    then per layer:
+      int32 in, out          widths, up to POLICY_MAX_WIDTH
+      int32 type             POLICY_F32 or POLICY_I8
+      int32 activation       POLICY_LINEAR, POLICY_RELU or POLICY_TANH
+      POLICY_F32: float32 w[out][in], float32 b[out]
+      POLICY_I8:  float32 scale[out], int8 w[out][in], float32 b[out]
+                  (row r's weights are scale[r] * w[r][k])
+
+  The first layer's in must be ENV_OBS and the last one's out ENV_ACT.
+  Weights are kept in one block allocated at load time, and evaluating
+  the network allocates nothing.
+*/
+
+#define POLICY_MAX_LAYERS 8
+#define POLICY_MAX_WIDTH 512
+
+#define POLICY_F32 0
+#define POLICY_I8 1
+
+#define POLICY_LINEAR 0
+#define POLICY_RELU 1
+#define POLICY_TANH 2
+
+int Policy_Load(const char *filename);
+int Policy_Loaded(void);
+void Policy_Eval(const float *in, float *out);
+
+#endif
@@ -0,0 +1,430 @@
+/*
+	Offline renderer for flight traces.
+
+	Usage: Lander_Render [-j threads] [-z zoom] [-a] [-l lander]... [-m map]
+	                     [-o prefix] [-e command] [-P] trace
+
+	e.g.   Lander_Swarm -T sweep.trace hard.ppm 300 2
+	       Lander_Render sweep.trace
+	       Lander_Render -l 17 -e 'ffmpeg -v error -y -f image2pipe -c:v ppm -r 25 -i - crash_%d.mp4' sweep.trace
+
+	Draws the flights in a trace (see Lander_Trace.h) frame by frame:
+	the map, the lander's sprite, thruster flames, sonar returns and
+	its trail, and under that its velocity history (the simulator's
+	plotHist() charts, vx red and vy blue) and a light per component,
+	red once it has failed. Nothing is simulated, so frames come out
+	as fast as the cores can draw them, -j threads at a time (default
+	one per core).
+
+	By default every lander that didn't land gets a sequence of its
+	own, -a renders them all and -l picks landers by number (it can be
+	given more than once). A sequence runs from the first frame of the
+	trace to TAIL_FRAMES after the lander came down, with a border in
+	the colour of its outcome once it has.
+
+	Frames are written as prefix_LLLL_FFFF.png, prefix defaulting to
+	the trace's name without its .trace, each by the thread that drew
+	it. With -e each lander's frames are piped in order into command
+	instead, as PPM with %d replaced by the lander number, which is
+	how to get a video out (an encoder reading images from its
+	standard input, as above). -m renders
+	over a different map than the one the trace was flown on, -z
+	shrinks the map by 1, 2 (default) or 4. A whole tiled world (see
+	Terrain_Tiles.h) is too big for one picture, so each frame shows
+	the 1024x1024 of it around the lander, drawn from the tiles there. -P profiles drawing against
+	writing frames out with the CPU's counters (see Lander_Perf.h),
+	over all the threads.
+*/
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Lander_Control.h"
+#include "Lander_PNG.h"
+#include "Lander_Perf.h"
+#include "Lander_Trace.h"
+#include "Terrain_Tiles.h"
+
+#define TAIL_FRAMES 25		// a second after the lander is down
+#define CHART_V 30.0		// velocity at the top of the chart
+#define FRAMES_PER_THREAD 4	// frames rendered at a time, per thread
+
+unsigned char *readPPMimage(const char *filename);
+
+static const struct Trace_File *trace;
+static unsigned char *background;	// the map, shrunk
+static struct Tile_Map *tiles;		// or the tiled world the view follows the lander around
+static unsigned char *sprite;		// lander.ppm, 64x64
+static int zoom = 2, width, height, chart_h;
+static struct Perf **perf;		// a profile per thread and one for the pipe, with -P
+
+// One pass over a run of a lander's frames
+struct Job {
+ int lander, first, count;
+ int next;			// next frame to take, shared by the threads
+ int started;			// threads so far, numbering their profiles
+ unsigned char **frames;	// count of them
+ const char *prefix;		// write each frame here as it's done, if set
+};
+
+static void Plot(unsigned char *im, int x, int y, int r, int g, int b)
+{
+ unsigned char *p;
+
+ if (x < 0 || x >= width || y < 0 || y >= height) return;
+ p = im + 3 * (y * width + x);
+ p[0] = r;
+ p[1] = g;
+ p[2] = b;
+}
+
+static void Line(unsigned char *im, double x0, double y0, double x1, double y1, int r, int g, int b)
+{
+ int steps = (int) fmax(fabs(x1 - x0), fabs(y1 - y0)) + 1;
+
+ for (int k = 0; k <= steps; k++)
+  Plot(im, (int) lrint(x0 + (x1 - x0) * k / steps), (int) lrint(y0 + (y1 - y0) * k / steps), r, g, b);
+}
+
+static void Box(unsigned char *im, int x0, int y0, int x1, int y1, int r, int g, int b)
+{
+ for (int y = y0; y <= y1; y++)
+  for (int x = x0; x <= x1; x++) Plot(im, x, y, r, g, b);
+}
+
+// A 1024x1024 map into width x width of im
+static void Shrink(const unsigned char *map, unsigned char *im)
+{
+ for (int y = 0; y < width; y++)
+  for (int x = 0; x < width; x++)
+   for (int c = 0; c < 3; c++) {
+    int sum = 0;
+
+    for (int dy = 0; dy < zoom; dy++)
+     for (int dx = 0; dx < zoom; dx++) sum += map[3 * ((y * zoom + dy) * SWARM_MAP_SIZE + x * zoom + dx) + c];
+    im[3 * (y * width + x) + c] = sum / (zoom * zoom);
+   }
+}
+
+// Left (or top) edge of the view of a tiled world size pixels across, around v
+static int View_Origin(double v, int size)
+{
+ int o = (int) v - SWARM_MAP_SIZE / 2;
+
+ if (o > size - SWARM_MAP_SIZE) o = size - SWARM_MAP_SIZE;
+ if (o < 0) o = 0;
+ return o - o % zoom;
+}
+
+// The world around the lander at (x, y), shrunk into im, and where the view's corner is
+static void Draw_View(unsigned char *im, double x, double y, int *ox, int *oy)
+{
+ unsigned char *view = (unsigned char *) malloc(SWARM_MAP_SIZE * SWARM_MAP_SIZE * 3);
+
+ *ox = View_Origin(x, tiles->terrain.width);
+ *oy = View_Origin(y, tiles->terrain.height);
+ if (!view) {
+  memset(im, 0, width * width * 3);
+  return;
+ }
+ Tile_Map_Window(tiles, *ox, *oy, SWARM_MAP_SIZE, SWARM_MAP_SIZE, view);
+ Shrink(view, im);
+ free(view);
+}
+
+// A flame len map pixels long out of (x, y) (map pixels) along (dx, dy)
+static void Flame(unsigned char *im, double x, double y, double dx, double dy, double len)
+{
+ if (len <= 0) return;
+ Line(im, x / zoom, y / zoom, (x + dx * len) / zoom, (y + dy * len) / zoom, 255, 160, 0);
+}
+
+// The sprite, turned clockwise by the lander's angle about its centre
+static void Draw_Lander(unsigned char *im, const struct Trace_Lander *l)
+{
+ double sa = sin(l->angle), ca = cos(l->angle);
+ int cx = (int) (l->x / zoom), cy = (int) (l->y / zoom), r = 46 / zoom;
+
+ // up is (sa, -ca) on the screen, the lander's right (ca, sa)
+ Flame(im, l->x - sa * 28, l->y + ca * 28, -sa, ca, l->main * 24.0 / 255);
+ Flame(im, l->x - ca * 26, l->y - sa * 26, -ca, -sa, l->left * 16.0 / 255);
+ Flame(im, l->x + ca * 26, l->y + sa * 26, ca, sa, l->right * 16.0 / 255);
+
+ for (int dy = -r; dy <= r; dy++)
+  for (int dx = -r; dx <= r; dx++) {
+   double sx = dx * zoom, sy = dy * zoom;
+   int u = (int) floor(sx * ca + sy * sa) + 32, v = (int) floor(sy * ca - sx * sa) + 32;
+   const unsigned char *p;
+
+   if (u < 0 || u > 63 || v < 0 || v > 63) continue;
+   p = sprite + 3 * (v * 64 + u);
+   if (p[0] | p[1] | p[2]) Plot(im, cx + dx, cy + dy, p[0], p[1], p[2]);
+  }
+}
+
+static double Chart_Y(double v)
+{
+ return width + chart_h / 2 - fmax(-1, fmin(v / CHART_V, 1)) * (chart_h / 2 - 2);
+}
+
+// Velocity history and component lights under the map
+static void Draw_Chart(unsigned char *im, int lander, int frame)
+{
+ int first = frame > HIST ? frame - HIST : 0, sq = chart_h / 8;
+ const struct Trace_Lander *l = Trace_At(trace, frame, lander);
+
+ Box(im, 0, width, width - 1, height - 1, 16, 16, 16);
+ Line(im, 0, Chart_Y(0), width - 1, Chart_Y(0), 64, 64, 64);
+ for (int f = first + 1; f <= frame; f++) {
+  const struct Trace_Lander *a = Trace_At(trace, f - 1, lander), *b = Trace_At(trace, f, lander);
+  double x0 = (double) (f - 1 - first) * (width - 1) / HIST, x1 = (double) (f - first) * (width - 1) / HIST;
+
+  Line(im, x0, Chart_Y(a->vx), x1, Chart_Y(b->vx), 255, 64, 64);
+  Line(im, x0, Chart_Y(a->vy), x1, Chart_Y(b->vy), 64, 160, 255);
+ }
+ for (int c = COMP_MAIN; c <= COMP_SONAR; c++) {
+  int x = 4 + (c - 1) * (sq + 3);
+
+  if (l->ok & (1 << c)) Box(im, x, width + 4, x + sq - 1, width + 3 + sq, 0, 200, 0);
+  else Box(im, x, width + 4, x + sq - 1, width + 3 + sq, 220, 0, 0);
+ }
+}
+
+static void Render_Frame(unsigned char *im, int lander, int frame)
+{
+ struct Trace_Lander v = *Trace_At(trace, frame, lander);
+ const struct Trace_Lander *l = &v;	// where it is in the view
+ static const unsigned char border[][3] = {{0, 0, 0}, {220, 0, 0}, {0, 200, 0}, {64, 64, 255}, {128, 128, 128}};
+ int ox = 0, oy = 0;
+
+ if (tiles) Draw_View(im, v.x, v.y, &ox, &oy);
+ else memcpy(im, background, width * width * 3);
+ v.x -= ox;
+ v.y -= oy;
+
+ // Trail, over the same stretch as the chart
+ for (int f = frame > HIST ? frame - HIST : 0; f < frame; f++) {
+  const struct Trace_Lander *t = Trace_At(trace, f, lander);
+
+  Plot(im, (int) ((t->x - ox) / zoom), (int) ((t->y - oy) / zoom), 160, 160, 0);
+ }
+
+ // Sonar returns, beam b is b * 10 degrees clockwise from straight up
+ for (int b = 0; b < SWARM_BEAMS; b++) {
+  double hx, hy;
+
+  if (l->sonar[b] < 0) continue;
+  hx = (l->x + sin(b * 10 * PI / 180) * l->sonar[b]) / zoom;
+  hy = (l->y - cos(b * 10 * PI / 180) * l->sonar[b]) / zoom;
+  Line(im, l->x / zoom, l->y / zoom, hx, hy, 0, 110, 0);
+  Box(im, (int) hx - 1, (int) hy - 1, (int) hx + 1, (int) hy + 1, 0, 255, 0);
+ }
+
+ Draw_Lander(im, l);
+ Draw_Chart(im, lander, frame);
+
+ if (l->status) {
+  const unsigned char *c = border[l->status];
+
+  Box(im, 0, 0, width - 1, 2, c[0], c[1], c[2]);
+  Box(im, 0, width - 3, width - 1, width - 1, c[0], c[1], c[2]);
+  Box(im, 0, 0, 2, width - 1, c[0], c[1], c[2]);
+  Box(im, width - 3, 0, width - 1, width - 1, c[0], c[1], c[2]);
+ }
+}
+
+static void Write_Frame(FILE *f, const unsigned char *im)
+{
+ fprintf(f, "P6\n%d %d\n255\n", width, height);
+ fwrite(im, 3, width * height, f);
+}
+
+static void *Worker(void *arg)
+{
+ struct Job *j = (struct Job *) arg;
+ struct Perf *p = perf ? perf[__atomic_fetch_add(&j->started, 1, __ATOMIC_RELAXED)] : NULL;
+ int k;
+
+ while ((k = __atomic_fetch_add(&j->next, 1, __ATOMIC_RELAXED)) < j->count) {
+  if (p) Perf_Switch(p, PERF_DRAW);
+  Render_Frame(j->frames[k], j->lander, j->first + k);
+  if (j->prefix) {
+   char name[1024];
+
+   if (p) Perf_Switch(p, PERF_OUTPUT);
+   snprintf(name, sizeof(name), "%s_%04d_%04d.png", j->prefix, j->lander, j->first + k);
+   if (!PNG_Write(name, j->frames[k], width, height)) perror(name);
+  }
+ }
+ if (p) Perf_Stop(p);
+ return NULL;
+}
+
+// Renders frames first - first + count - 1 of a lander, threads at a time
+static void Run(struct Job *j, int threads)
+{
+ pthread_t tid[threads];
+
+ j->next = j->started = 0;
+ for (int t = 1; t < threads; t++) pthread_create(&tid[t], NULL, Worker, j);
+ Worker(j);
+ for (int t = 1; t < threads; t++) pthread_join(tid[t], NULL);
+}
+
+// command with each %d replaced by the lander number
+static void Command(const char *command, int lander, char *out, size_t size)
+{
+ size_t k = 0;
+
+ for (const char *c = command; *c && k + 16 < size; c++)
+  if (c[0] == '%' && c[1] == 'd') {
+   k += snprintf(out + k, size - k, "%d", lander);
+   c++;
+  } else out[k++] = *c;
+ out[k] = 0;
+}
+
+// The frame a lander came down on, or the last one
+static int End_Frame(int lander)
+{
+ for (int f = 0; f < trace->frames; f++)
+  if (Trace_At(trace, f, lander)->status) return f;
+ return trace->frames - 1;
+}
+
+static int Picked(int i, const int *picked, int n)
+{
+ for (int k = 0; k < n; k++)
+  if (picked[k] == i) return 1;
+ return 0;
+}
+
+int main(int argc, char *argv[])
+{
+ const char *map = NULL, *command = NULL;
+ char prefix[1024];
+ int opt, threads = sysconf(_SC_NPROCESSORS_ONLN), all = 0, chunk, landers = 0, profile = 0;
+ long frames = 0;
+ int picked[argc], n_picked = 0;
+ unsigned char *im;
+ struct Trace_File *t;
+ struct timespec t0, t1;
+ double wall;
+
+ prefix[0] = 0;
+ while ((opt = getopt(argc, argv, "j:z:al:m:o:e:P")) != -1) {
+  if (opt == 'j') threads = atoi(optarg);
+  else if (opt == 'z') zoom = atoi(optarg);
+  else if (opt == 'a') all = 1;
+  else if (opt == 'l') picked[n_picked++] = atoi(optarg);
+  else if (opt == 'm') map = optarg;
+  else if (opt == 'o') snprintf(prefix, sizeof(prefix), "%s", optarg);
+  else if (opt == 'e') command = optarg;
+  else if (opt == 'P') profile = 1;
+  else break;
+ }
+ if (argc - optind != 1 || (zoom != 1 && zoom != 2 && zoom != 4)) {
+  fprintf(stderr, "Usage: Lander_Render [-j threads] [-z zoom] [-a] [-l lander]... [-m map]\n"
+                  "                     [-o prefix] [-e command] [-P] trace\n");
+  return 1;
+ }
+ if (threads < 1) threads = 1;
+ if (profile) {
+  perf = (struct Perf **) calloc(threads + 1, sizeof(struct Perf *));
+  for (int k = 0; perf && k <= threads; k++)
+   if (!(perf[k] = Perf_Create())) return 1;
+  if (!perf) return 1;
+ }
+
+ trace = t = Trace_Map(argv[optind]);
+ if (!t || !t->frames) {
+  fprintf(stderr, "%s is not a flight trace, or is empty\n", argv[optind]);
+  return 1;
+ }
+ if (!prefix[0]) {
+  const char *dot = strrchr(argv[optind], '.');
+
+  snprintf(prefix, sizeof(prefix), "%.*s", dot && !strcmp(dot, ".trace") ? (int) (dot - argv[optind]) : 1000,
+           argv[optind]);
+ }
+ width = SWARM_MAP_SIZE / zoom;
+ chart_h = width / 5;
+ height = width + chart_h;
+ if (!map) map = t->head->map;
+ if (Tile_Map_Whole(map)) {
+  if (!(tiles = Tile_Map_Open(map + 5))) {
+   fprintf(stderr, "Unable to open tile map %s\n", map + 5);
+   return 1;
+  }
+ } else {
+  if (!(im = readPPMimage(map)) || !(background = (unsigned char *) malloc(width * width * 3))) return 1;
+  Shrink(im, background);
+  free(im);
+ }
+ sprite = readPPMimage("lander.ppm");
+ if (!sprite) return 1;
+
+ chunk = threads * FRAMES_PER_THREAD;
+ unsigned char *frames_buf[chunk];
+ for (int k = 0; k < chunk; k++)
+  if (!(frames_buf[k] = (unsigned char *) malloc(width * height * 3))) return 1;
+
+ clock_gettime(CLOCK_MONOTONIC, &t0);
+ for (int i = 0; i < t->head->n; i++) {
+  int end = End_Frame(i), last = end + TAIL_FRAMES < t->frames ? end + TAIL_FRAMES : t->frames - 1;
+  int status = Trace_At(t, t->frames - 1, i)->status;
+  FILE *pipe = NULL;
+  struct Job j;
+
+  if (n_picked ? !Picked(i, picked, n_picked) : !all && status == SWARM_LANDED) continue;
+  if (command) {
+   char cmd[4096];
+
+   Command(command, i, cmd, sizeof(cmd));
+   if (!(pipe = popen(cmd, "w"))) {
+    perror(cmd);
+    return 1;
+   }
+  }
+  j.lander = i;
+  j.frames = frames_buf;
+  j.prefix = pipe ? NULL : prefix;
+  for (j.first = 0; j.first <= last; j.first += chunk) {
+   j.count = last + 1 - j.first < chunk ? last + 1 - j.first : chunk;
+   Run(&j, threads);
+   if (pipe) {
+    if (perf) Perf_Switch(perf[threads], PERF_OUTPUT);
+    for (int k = 0; k < j.count; k++) Write_Frame(pipe, frames_buf[k]);
+    if (perf) Perf_Stop(perf[threads]);
+   }
+  }
+  if (pipe && pclose(pipe)) fprintf(stderr, "Lander %d: the encoder failed\n", i);
+  frames += last + 1;
+  landers++;
+ }
+ clock_gettime(CLOCK_MONOTONIC, &t1);
+ wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+
+ printf("%ld frames of %d landers in %.2fs (%.0f frames per second on %d threads)\n", frames, landers, wall,
+        frames / wall, threads);
+ if (perf) {
+  for (int k = 1; k <= threads; k++) {
+   Perf_Add(perf[0], perf[k]);
+   Perf_Free(perf[k]);
+  }
+  Perf_Report(perf[0], stdout);
+  Perf_Free(perf[0]);
+  free(perf);
+ }
+ for (int k = 0; k < chunk; k++) free(frames_buf[k]);
+ free(background);
+ if (tiles) Tile_Map_Close(tiles);
+ free(sprite);
+ Trace_Unmap(t);
+ return 0;
+}
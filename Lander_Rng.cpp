@@ -0,0 +1,87 @@
+/*
+	Philox4x32-10 (see Lander_Rng.h).
+
+	The counter is (tick, channel, draw) and the key is (seed, stream).
+	Each block gives 128 random bits, we use 52 of them per number.
+*/
+
+#include <string.h>
+#include <time.h>
+
+#include "Lander_Rng.h"
+#include "Lander_State.h"
+
+#define PHILOX_M0 0xd2511f53u
+#define PHILOX_M1 0xcd9e8d57u
+#define PHILOX_W0 0x9e3779b9u
+#define PHILOX_W1 0xbb67ae85u
+
+static inline double Philox(unsigned int c0, unsigned int c1, unsigned int c2, unsigned int c3,
+                            unsigned int k0, unsigned int k1)
+{
+ for (int r = 0; r < 10; r++) {
+  unsigned long long p0 = (unsigned long long) PHILOX_M0 * c0;
+  unsigned long long p1 = (unsigned long long) PHILOX_M1 * c2;
+  unsigned int n0 = (unsigned int) (p1 >> 32) ^ c1 ^ k0;
+  unsigned int n2 = (unsigned int) (p0 >> 32) ^ c3 ^ k1;
+
+  c1 = (unsigned int) p1;
+  c3 = (unsigned int) p0;
+  c0 = n0;
+  c2 = n2;
+  k0 += PHILOX_W0;
+  k1 += PHILOX_W1;
+ }
+ // 52 random mantissa bits under the exponent of 1.0 give [1, 2)
+ unsigned long long bits = 0x3ff0000000000000ULL | (unsigned long long) c0 << 20 | c1 >> 12;
+ double d;
+ memcpy(&d, &bits, sizeof(d));
+ return d - 1;
+}
+
+// Uniform in [0, 1)
+double Rng_Uniform(unsigned int seed, unsigned int stream, unsigned long tick,
+                   unsigned int channel, unsigned int draw)
+{
+ return Philox((unsigned int) tick, (unsigned int) (tick >> 32), channel, draw, seed, stream);
+}
+
+/*
+  out[i] = Rng_Uniform(seed, first_stream + i, tick, channel, draw),
+  n streams at once (the same number from every lander's stream).
+*/
+__attribute__((target_clones("avx512f", "avx2", "default")))
+void Rng_Batch(unsigned int seed, unsigned int first_stream, int n, unsigned long tick,
+               unsigned int channel, unsigned int draw, double *out)
+{
+ for (int i = 0; i < n; i++)
+  out[i] = Philox((unsigned int) tick, (unsigned int) (tick >> 32), channel, draw, seed, first_stream + i);
+}
+
+// out[k] = Rng_Uniform(seed, stream, tick, channel, first_draw + k), n draws at once
+__attribute__((target_clones("avx512f", "avx2", "default")))
+void Rng_Draws(unsigned int seed, unsigned int stream, unsigned long tick,
+               unsigned int channel, unsigned int first_draw, int n, double *out)
+{
+ for (int k = 0; k < n; k++)
+  out[k] = Philox((unsigned int) tick, (unsigned int) (tick >> 32), channel, first_draw + k, seed, stream);
+}
+
+/*
+  Outside the swarm (the simulator flies one lander and doesn't say
+  which run it is) a controller gets lander 0 of a run seeded once,
+  from the clock, when it first asks. The swarm's own definitions
+  replace these.
+*/
+__attribute__((weak)) unsigned int Lander_Seed(void)
+{
+ static unsigned int seed;
+
+ if (!seed) seed = (unsigned int) time(NULL) | 1;
+ return seed;
+}
+
+__attribute__((weak)) unsigned int Lander_Id(void)
+{
+ return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef _LANDER_RNG_H
+#define _LANDER_RNG_H
+
+/*
+  Counter-based random numbers (Philox4x32-10, Salmon et al., "Parallel
+  random numbers: as easy as 1, 2, 3").
+
+  There's no generator state: a number is a pure function of
+  (seed, stream, tick, channel, draw), so any lander's noise at any
+  tick can be produced in any order, on any thread, and comes out the
+  same. A stream is normally a lander, the channel says what the
+  number is for, and draw counts the numbers taken from one channel
+  during one tick. Keeping the channels apart means an extra sensor
+  read in a controller doesn't shift the noise on everything else.
+*/
+
+// Channels
+#define RNG_START 0	// initial conditions
+#define RNG_FAIL 1	// failure times and components
+#define RNG_MAIN 2	// actuator noise
+#define RNG_LEFT 3
+#define RNG_RIGHT 4
+#define RNG_ROTATE 5
+#define RNG_VX 6	// sensor noise
+#define RNG_VY 7
+#define RNG_PX 8
+#define RNG_PY 9
+#define RNG_ANGLE 10
+#define RNG_SONAR 11	// draw is the beam
+#define RNG_CONTROL 12	// for the controllers' own use
+#define RNG_CHANNELS 13
+
+double Rng_Uniform(unsigned int seed, unsigned int stream, unsigned long tick,
+                   unsigned int channel, unsigned int draw);
+void Rng_Batch(unsigned int seed, unsigned int first_stream, int n, unsigned long tick,
+               unsigned int channel, unsigned int draw, double *out);
+void Rng_Draws(unsigned int seed, unsigned int stream, unsigned long tick,
+               unsigned int channel, unsigned int first_draw, int n, double *out);
+
+#endif
@@ -0,0 +1,94 @@
+/*
+	Terrain table from the laser range finder (see Lander_Scan.h).
+*/
+
+#include <math.h>
+
+#include "Lander_Control.h"
+#include "Lander_Events.h"
+#include "Lander_Scan.h"
+#include "Lander_Sensors.h"
+#include "Lander_State.h"
+
+#define LASER_OFFSET 19		// RangeDist() counts from the edge of the hull, sonar from the centre
+
+CONTROLLER_STATE static double dist[SCAN_BEARINGS];
+CONTROLLER_STATE static double taken[SCAN_BEARINGS];	// seconds
+CONTROLLER_STATE static unsigned long long seen = 0;	// bit b set once bearing b has a reading
+CONTROLLER_STATE static int last = -1;			// bearing of the last reading
+CONTROLLER_STATE static double looked = -SCAN_STALE;	// when Scan_Due() last sent us to look
+
+static double Now(void)
+{
+ return Events_Ticks() * T_STEP;
+}
+
+// Sonar bearing nearest to a direction in degrees (0 up, clockwise)
+static int Bearing(double deg)
+{
+ deg = fmod(deg, 360.0);
+ if (deg < 0) deg += 360;
+ return (int) lround(deg / 10) % SCAN_BEARINGS;
+}
+
+// Call once per tick, reads the laser if it's pointing somewhere new
+void Scan_Tick(void)
+{
+ int b = Bearing(Sensed_Angle() + 180);	// the laser looks out of the main thruster
+ double r;
+
+ if (b == last && Now() - taken[b] < SCAN_REFRESH) return;
+ r = RangeDist();
+ dist[b] = r < 0 ? SCAN_FAR : r + LASER_OFFSET;
+ taken[b] = Now();
+ seen |= 1ULL << b;
+ last = b;
+}
+
+// 1 for a reading taken just now, down to 0 once it's SCAN_STALE old
+double Scan_Confidence(int bearing)
+{
+ if (!(seen & (1ULL << bearing))) return 0;
+ return fmax(0, 1 - (Now() - taken[bearing]) / SCAN_STALE);
+}
+
+// Latest reading on bearing, less how far we've moved towards it since
+double Scan_Distance(int bearing)
+{
+ double b = bearing * 10 * PI / 180, closing;
+
+ if (dist[bearing] >= SCAN_FAR) return SCAN_FAR;
+ closing = (Sensed_VX() * sin(b) + Sensed_VY() * cos(b)) * S_SCALE * (Now() - taken[bearing]);
+ return fmax(0, dist[bearing] - closing);
+}
+
+// Smallest usable reading over bearings [from, to), like Sonar_Min()
+double Scan_Min(int from, int to)
+{
+ double dmin = SCAN_FAR;
+
+ for (int b = from; b < to; b++)
+  if (Scan_Confidence(b) > 0) dmin = fmin(dmin, Scan_Distance(b));
+ return dmin;
+}
+
+/*
+  1 if we're moving towards a bearing the laser hasn't looked along
+  lately, with the lander angle that points it there in *angle.
+  Falling straight down is looked after by the laser when upright.
+*/
+int Scan_Due(double *angle)
+{
+ double vx = Sensed_VX(), vy = Sensed_VY(), heading;
+ int b;
+
+ if (vx * vx + vy * vy < 4 || Now() - looked < SCAN_STALE) return 0;
+ heading = atan2(vx, vy) * 180 / PI;
+ b = Bearing(heading);
+ // Either neighbour will do, the heading wobbles by more than that
+ for (int k = -1; k <= 1; k++)
+  if (Scan_Confidence((b + k + SCAN_BEARINGS) % SCAN_BEARINGS) > .25) return 0;
+ *angle = fmod(heading + 360 + 180, 360.0);
+ looked = Now();
+ return 1;
+}
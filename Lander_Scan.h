@@ -0,0 +1,37 @@
+#ifndef _LANDER_SCAN_H
+#define _LANDER_SCAN_H
+
+/*
+  Terrain table from the laser range finder.
+
+  RangeDist() only looks out along the main thruster, so with the
+  sonar gone the only way to see around is to turn, and a full turn
+  just to look costs a lot of altitude (see REPORT.TXT). But the
+  lander turns anyway, to swap thrusters and to right itself, so
+  Scan_Tick() takes a reading whenever the laser has swung onto a new
+  bearing (and now and then when it hasn't), and keeps the latest
+  reading on each of the sonar's 36 bearings with the time it was
+  taken.
+
+  Readings are sonar-equivalent: distance from the centre of the
+  lander, bearing b in the same 10 degree slices as SONAR_DIST[b].
+  Scan_Min() works like a sonar sector minimum, with each reading
+  moved on by how far the lander has travelled towards it since, and
+  readings too old to trust left out. Scan_Due() says when the
+  direction the lander is moving in hasn't been looked at for too
+  long, and where to point to look.
+*/
+
+#define SCAN_BEARINGS 36
+#define SCAN_STALE 2.0		// seconds before a reading is no use
+#define SCAN_REFRESH .25	// re-read the current bearing this often
+#define SCAN_REACH 225.0	// how far the sonar hears between pings, farther counts as nothing
+#define SCAN_FAR 1000000.0	// nothing in range
+
+void Scan_Tick(void);
+double Scan_Confidence(int bearing);
+double Scan_Distance(int bearing);
+double Scan_Min(int from, int to);
+int Scan_Due(double *angle);
+
+#endif
@@ -0,0 +1,99 @@
+/*
+	Per-tick sensor snapshot (see Lander_Sensors.h).
+
+	Ticks are Events_Poll()'s, so a snapshot taken before the first
+	poll of a tick can't be mistaken for one of it.
+*/
+
+#include <math.h>
+
+#include "Lander_Control.h"
+#include "Lander_Events.h"
+#include "Lander_Sensors.h"
+#include "Lander_State.h"
+
+CONTROLLER_STATE static struct Sensor_Snapshot snap = {{-1, -1, -1, -1, -1}, {0, 0, 0, 0, 0}, {0, 0, 0, 0, 0}};
+
+static double Sample(int sensor)
+{
+ switch (sensor) {
+  case SENSOR_VX: return Velocity_X();
+  case SENSOR_VY: return Velocity_Y();
+  case SENSOR_PX: return Position_X();
+  case SENSOR_PY: return Position_Y();
+ }
+ return Angle();
+}
+
+// This tick's reading of sensor
+double Sensed(int sensor)
+{
+ if (snap.tick[sensor] != Events_Ticks()) {
+  snap.tick[sensor] = Events_Ticks();
+  snap.value[sensor] = Sample(sensor);
+  snap.reads[sensor]++;
+ }
+ return snap.value[sensor];
+}
+
+double Sensed_VX(void)
+{
+ return Sensed(SENSOR_VX);
+}
+
+double Sensed_VY(void)
+{
+ return Sensed(SENSOR_VY);
+}
+
+double Sensed_PX(void)
+{
+ return Sensed(SENSOR_PX);
+}
+
+double Sensed_PY(void)
+{
+ return Sensed(SENSOR_PY);
+}
+
+double Sensed_Angle(void)
+{
+ return Sensed(SENSOR_ANGLE);
+}
+
+// Averages n new samples of sensor and makes that this tick's reading
+double Sensors_Oversample(int sensor, int n)
+{
+ if (n < 1) return Sensed(sensor);
+ snap.tick[sensor] = Events_Ticks();
+ snap.value[sensor] = Sensor_Mean(sensor, n);
+ snap.reads[sensor] += n;
+ return snap.value[sensor];
+}
+
+unsigned long Sensors_Reads(int sensor)
+{
+ return snap.reads[sensor];
+}
+
+/*
+  Mean of n samples, the hard way. Angles are averaged as offsets from
+  the first one so readings either side of 0 don't average to 180.
+*/
+double Sensor_Mean_Sampled(int sensor, int n)
+{
+ double first = Sample(sensor), sum = 0, mean;
+
+ for (int i = 1; i < n; i++) {
+  double d = Sample(sensor) - first;
+  sum += sensor == SENSOR_ANGLE ? remainder(d, 360.0) : d;
+ }
+ mean = first + sum / n;
+ if (sensor == SENSOR_ANGLE) mean = fmod(mean + 360.0, 360.0);
+ return mean;
+}
+
+__attribute__((weak)) double Sensor_Mean(int sensor, int n)
+{
+ return Sensor_Mean_Sampled(sensor, n);
+}
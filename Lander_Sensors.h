@@ -0,0 +1,46 @@
+#ifndef _LANDER_SENSORS_H
+#define _LANDER_SENSORS_H
+
+/*
+  Per-tick sensor snapshot.
+
+  Every call to Position_X(), Velocity_X() etc. is a fresh noisy
+  sample, so a controller reading a sensor in several places compares
+  different values in each, and makes a simulator call for each. The
+  Sensed_*() reads take one sample of a sensor on the first read in a
+  tick and hand the same value out for the rest of it, so every
+  decision in a tick sees the same state.
+
+  When one sample isn't good enough, Sensors_Oversample() averages n
+  fresh ones and keeps the average as the tick's value. The averaging
+  goes through Sensor_Mean(), which just loops over the simulator call
+  here, simulations that can do better (Lander_Swarm.cpp) supply
+  their own.
+*/
+
+#define SENSOR_VX 0
+#define SENSOR_VY 1
+#define SENSOR_PX 2
+#define SENSOR_PY 3
+#define SENSOR_ANGLE 4
+#define SENSORS 5
+
+struct Sensor_Snapshot {
+ long tick[SENSORS];		// Events_Ticks() the value was sampled on, -1 for never
+ double value[SENSORS];
+ unsigned long reads[SENSORS];	// simulator samples taken so far
+};
+
+double Sensed(int sensor);
+double Sensed_VX(void);
+double Sensed_VY(void);
+double Sensed_PX(void);
+double Sensed_PY(void);
+double Sensed_Angle(void);
+double Sensors_Oversample(int sensor, int n);
+unsigned long Sensors_Reads(int sensor);
+
+double Sensor_Mean(int sensor, int n);
+double Sensor_Mean_Sampled(int sensor, int n);
+
+#endif
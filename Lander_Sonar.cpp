@@ -0,0 +1,56 @@
+/*
+	Double buffered sonar frames (see Lander_Sonar.h).
+
+	One writer (whoever steps the simulation), any number of readers.
+*/
+
+#include <string.h>
+
+#include "Lander_Control.h"
+#include "Lander_Sonar.h"
+#include "Lander_State.h"
+
+CONTROLLER_STATE static struct Sonar_Frame frames[2];
+CONTROLLER_STATE static unsigned int seq = 0;	// frames[seq & 1] is the current sweep
+
+/*
+  Call once per simulation step, after the simulator has had its
+  chance to ping. Publishes SONAR_DIST[] if it changed.
+*/
+void Sonar_Publish(double time)
+{
+ struct Sonar_Frame *cur = &frames[seq & 1], *next = &frames[(seq + 1) & 1];
+
+ if (seq && !memcmp(cur->dist, SONAR_DIST, sizeof(cur->dist))) return;
+
+ memcpy(next->dist, SONAR_DIST, sizeof(next->dist));
+ next->valid = 0;
+ for (int i = 0; i < SONAR_BEAMS; i++)
+  if (next->dist[i] > -1) next->valid |= 1ULL << i;
+ next->time = time;
+ next->seq = seq + 1;
+ __atomic_store_n(&seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+// Sequence number of the latest sweep, cheap enough to check every tick
+unsigned int Sonar_Seq(void)
+{
+ return __atomic_load_n(&seq, __ATOMIC_ACQUIRE);
+}
+
+/*
+  Copies the latest sweep into f. Returns 1 if it is newer than
+  last_seq, 0 (leaving f alone) if nothing changed since.
+*/
+int Sonar_Read(struct Sonar_Frame *f, unsigned int last_seq)
+{
+ unsigned int s;
+
+ do {
+  s = __atomic_load_n(&seq, __ATOMIC_ACQUIRE);
+  if (s == last_seq) return 0;
+  memcpy(f, &frames[s & 1], sizeof(*f));
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+ } while (__atomic_load_n(&seq, __ATOMIC_RELAXED) != s);
+ return 1;
+}
@@ -0,0 +1,33 @@
+#ifndef _LANDER_SONAR_H
+#define _LANDER_SONAR_H
+
+/*
+  Published sonar frames.
+
+  The simulator overwrites SONAR_DIST[] in place whenever a ping comes
+  in, so a reader can't tell a fresh sweep from an old one, and once
+  the simulation and the controllers run on different threads it could
+  see half of one sweep and half of the next. Sonar_Publish() copies
+  each new sweep into one of two frames and then bumps a sequence
+  number, readers copy the frame matching the sequence number they saw
+  and retry if it moved on meanwhile (the writer never touches the
+  frame a reader is on unless two pings go by during one copy).
+
+  A sweep identical to the previous one isn't published, so seq counts
+  sweeps that changed something rather than every ping.
+*/
+
+#define SONAR_BEAMS 36
+
+struct Sonar_Frame {
+ unsigned int seq;		// 1 for the first sweep, 0 means none yet
+ double time;			// simulated time the sweep was published
+ unsigned long long valid;	// bit i set if dist[i] is a real return (not -1)
+ double dist[SONAR_BEAMS];
+};
+
+void Sonar_Publish(double time);
+unsigned int Sonar_Seq(void);
+int Sonar_Read(struct Sonar_Frame *f, unsigned int last_seq);
+
+#endif
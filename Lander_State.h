@@ -0,0 +1,34 @@
+#ifndef _LANDER_STATE_H
+#define _LANDER_STATE_H
+
+/*
+  Everything the flight computer remembers from one tick to the next
+  (Lander.cpp, Lander_Events.cpp, Lander_Sonar.cpp) is declared
+  CONTROLLER_STATE, which puts it in its own linker section. The
+  linker brackets the section with __start_/__stop_ symbols, so a
+  simulator flying several landers can give each one its own
+  controller instance by swapping that block of memory in and out
+  around the calls to Lander_Control() (see Lander_Swarm.cpp).
+
+  Any new global or static the controllers keep across ticks has to
+  be declared CONTROLLER_STATE too, or it will be shared by all the
+  landers in a swarm.
+*/
+
+#define CONTROLLER_STATE __attribute__((section("lander_state")))
+
+extern char __start_lander_state[];
+extern char __stop_lander_state[];
+
+/*
+  Which run and which lander in it the controller is flying, so a
+  controller drawing its own numbers from Lander_Rng.h (channel
+  RNG_CONTROL) keys them the way the simulation keys its own. The
+  swarm supplies these (Lander_Swarm.cpp, for the lander
+  Swarm_Select() picked); anywhere else Lander_Rng.cpp answers with
+  lander 0 of a seed picked at startup.
+*/
+unsigned int Lander_Seed(void);
+unsigned int Lander_Id(void);
+
+#endif
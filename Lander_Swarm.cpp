@@ -0,0 +1,632 @@
+/*
+	Multi-lander simulation (see Lander_Swarm.h).
+
+	The dynamics, noise model, sonar and collision rules are the
+	simulator's, tick for tick: physics, then failures, then the
+	controllers, then sonar returns and collisions. Noise comes from
+	Lander_Rng.cpp keyed by lander and tick, so a lander's flight
+	doesn't depend on how many others are in the swarm or the order
+	they are stepped in.
+*/
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Lander_Assets.h"
+#include "Lander_Control.h"
+#include "Lander_Exec.h"
+#include "Lander_Faults.h"
+#include "Lander_Kernel.h"
+#include "Lander_Perf.h"
+#include "Lander_Rng.h"
+#include "Lander_Sensors.h"
+#include "Lander_State.h"
+#include "Lander_Swarm.h"
+#include "Lander_Trace.h"
+#include "Terrain_Tiles.h"
+
+unsigned char *readPPMimage(const char *filename);
+
+// The controller API's globals, loaded from the lander being controlled
+int MT_OK = 1;
+int RT_OK = 1;
+int LT_OK = 1;
+double PLAT_X;
+double PLAT_Y;
+double SONAR_DIST[36];
+
+static struct Swarm *cur;	// lander the controller API is talking to
+static int ci;
+
+static char *pristine;		// controller state before any lander flew
+
+// Next number from lander i's channel ch this tick
+static double U(int i, int ch)
+{
+ return Rng_Uniform(cur->seed, i, cur->tick, ch, cur->draws[i][ch]++);
+}
+
+static double *Alloc(int n)
+{
+ return (double *) calloc(n, sizeof(double));
+}
+
+static int Load_Hull(struct Swarm *s)
+{
+ unsigned char *im = readPPMimage("lander.ppm");
+
+ if (!im) return 0;
+ s->hull = (unsigned long long *) calloc(64, sizeof(unsigned long long));
+ if (!s->hull) {
+  free(im);
+  return 0;
+ }
+ for (int p = 0; p < 64 * 64; p++)
+  if (im[3 * p] || im[3 * p + 1] || im[3 * p + 2]) s->hull[p >> 6] |= 1ULL << (p & 63);
+ free(im);
+ return 1;
+}
+
+// Per lander arrays and controller instances for n landers
+static int Alloc_Landers(struct Swarm *s, int n)
+{
+ s->n = n;
+ s->x = Alloc(n); s->y = Alloc(n);
+ s->vx = Alloc(n); s->vy = Alloc(n);
+ s->angle = Alloc(n); s->rot = Alloc(n);
+ s->sin_a = Alloc(n); s->cos_a = Alloc(n);
+ s->main_p = Alloc(n); s->left_p = Alloc(n); s->right_p = Alloc(n);
+ s->ok = (int *) calloc(n, sizeof(int));
+ s->plan = (const struct Fault_Plan **) calloc(n, sizeof(*s->plan));
+ s->fault = (struct Fault_State *) calloc(n * FAULT_MAX, sizeof(struct Fault_State));
+ s->fault_next = (long *) calloc(n, sizeof(long));
+ s->fx = (unsigned char *) calloc(n * FAULT_COMPS, 1);
+ s->fx_value = Alloc(n * FAULT_COMPS);
+ s->status = (int *) calloc(n, sizeof(int));
+ s->end_tick = (long *) calloc(n, sizeof(long));
+ s->launch = (long *) calloc(n, sizeof(long));
+ s->s_dst = Alloc(n * SWARM_BEAMS);
+ s->s_dir = Alloc(n * SWARM_BEAMS);
+ s->sonar = Alloc(n * SWARM_BEAMS);
+ s->draws = (unsigned short (*)[RNG_CHANNELS]) calloc(n, sizeof(*s->draws));
+
+ // Every lander starts from the controllers' initial state
+ s->ctl_size = __stop_lander_state - __start_lander_state;
+ if (!pristine) {
+  if (!(pristine = (char *) malloc(s->ctl_size))) return 0;
+  memcpy(pristine, __start_lander_state, s->ctl_size);
+ }
+ s->ctl = (char *) malloc(n * s->ctl_size);
+ return s->x && s->y && s->vx && s->vy && s->angle && s->rot && s->sin_a && s->cos_a &&
+        s->main_p && s->left_p && s->right_p && s->ok && s->plan && s->fault && s->fault_next &&
+        s->fx && s->fx_value && s->status && s->end_tick && s->launch &&
+        s->s_dst && s->s_dir && s->sonar && s->draws && s->ctl;
+}
+
+/*
+  Starts lander i's flight from scratch on this tick, with x, y, vx,
+  vy and angle holding the uniform draws for its starting state.
+*/
+static void Launch(struct Swarm *s, int i)
+{
+ // Starting state as in the simulator, spread across a wider world
+ s->x[i] = 50 + (s->width - 99) * s->x[i];
+ s->y[i] = 50 + 50 * s->y[i];
+ s->vx[i] = 25 * s->vx[i] - 12.5;
+ s->vy[i] = -15 * s->vy[i];
+ s->angle[i] = 2 * PI * s->angle[i];
+ sincos(s->angle[i], &s->sin_a[i], &s->cos_a[i]);
+ s->rot[i] = 0;
+ s->main_p[i] = s->left_p[i] = s->right_p[i] = 0;
+ s->ok[i] = COMP_ALL;
+ s->fault_next[i] = LONG_MAX;
+ memset(s->fx + i * FAULT_COMPS, 0, FAULT_COMPS);
+ s->status[i] = SWARM_FLYING;
+ s->end_tick[i] = 0;
+ s->launch[i] = s->tick;
+ for (int b = 0; b < SWARM_BEAMS; b++) {
+  s->s_dir[i * SWARM_BEAMS + b] = 1;
+  s->s_dst[i * SWARM_BEAMS + b] = 15;
+  s->sonar[i * SWARM_BEAMS + b] = -1;
+ }
+ memcpy(s->ctl + i * s->ctl_size, pristine, s->ctl_size);
+}
+
+/*
+  A built in map (see Lander_Assets.h) is flown as it is, mask and
+  platform included, a tiled world is mapped, and anything else is
+  loaded and its mask built. Whatever was set up by the time something
+  fails goes back through Swarm_Free().
+*/
+struct Swarm *Swarm_Create(const char *map, int n, unsigned int seed)
+{
+ struct Swarm *s = (struct Swarm *) calloc(1, sizeof(struct Swarm));
+ struct Asset a;
+
+ if (!s) return NULL;
+ if (n < 1) goto fail;
+ s->width = s->height = SWARM_MAP_SIZE;
+ if (Tile_Map_Whole(map)) {
+  if (!(s->tiles = Tile_Map_Open(map + 5))) {
+   fprintf(stderr, "Unable to open tile map %s\n", map + 5);
+   goto fail;
+  }
+  s->width = s->tiles->terrain.width;
+  s->height = s->tiles->terrain.height;
+  Tile_Map_Platform(s->tiles, &s->plat_x, &s->plat_y);
+ } else if (Asset_Find(map, &a) && a.mask && a.width == SWARM_MAP_SIZE && a.height == SWARM_MAP_SIZE) {
+  s->map = a.rgb;
+  s->mask = a.mask;
+  s->plat_x = a.plat_x;
+  s->plat_y = a.plat_y;
+  s->builtin = 1;
+ } else {
+  unsigned char *im = readPPMimage(map);
+
+  if (!im) goto fail;
+  s->map = im;
+  if (!(s->mask = Terrain_Mask_Build(im))) goto fail;
+  Terrain_Platform(im, &s->plat_x, &s->plat_y);
+ }
+ if (!Load_Hull(s) || !Alloc_Landers(s, n)) goto fail;
+ if (!(s->refs = (int *) malloc(sizeof(int)))) goto fail;
+ *s->refs = 1;
+
+ s->seed = seed;
+ Rng_Batch(seed, 0, n, 0, RNG_START, 0, s->x);
+ Rng_Batch(seed, 0, n, 0, RNG_START, 1, s->y);
+ Rng_Batch(seed, 0, n, 0, RNG_START, 2, s->vx);
+ Rng_Batch(seed, 0, n, 0, RNG_START, 3, s->vy);
+ Rng_Batch(seed, 0, n, 0, RNG_START, 4, s->angle);
+ for (int i = 0; i < n; i++) Launch(s, i);
+ return s;
+
+fail:
+ Swarm_Free(s);
+ return NULL;
+}
+
+/*
+  Lander i starts a new flight from a fresh starting position, drawn
+  from its stream at this tick, with its fault plan started over
+  (onset times count from now) and the controllers' initial state.
+*/
+void Swarm_Reset(struct Swarm *s, int i)
+{
+ double *start[5] = {s->x, s->y, s->vx, s->vy, s->angle};
+
+ for (int d = 0; d < 5; d++) start[d][i] = Rng_Uniform(s->seed, i, s->tick, RNG_START, d);
+ Launch(s, i);
+ if (s->plan[i]) Faults_Start(s, i);
+}
+
+/*
+  The map, mask and hull go with the last swarm sharing them. A swarm
+  Swarm_Create() gave up on shares nothing yet (refs is NULL) and
+  owns whatever of them it got.
+*/
+void Swarm_Free(struct Swarm *s)
+{
+ if (!s->refs || !--*s->refs) {
+  if (!s->builtin) {
+   free((void *) s->map);
+   free((void *) s->mask);
+  }
+  if (s->tiles) Tile_Map_Close(s->tiles);
+  free(s->hull); free(s->refs);
+ }
+ free(s->x); free(s->y); free(s->vx); free(s->vy);
+ free(s->angle); free(s->rot); free(s->sin_a); free(s->cos_a);
+ free(s->main_p); free(s->left_p); free(s->right_p);
+ free(s->ok); free(s->plan); free(s->fault); free(s->fault_next);
+ free(s->fx); free(s->fx_value);
+ free(s->status); free(s->end_tick); free(s->launch);
+ free(s->s_dst); free(s->s_dir); free(s->sonar);
+ free(s->draws); free(s->ctl);
+ free(s);
+}
+
+/*
+  Gives lander i a fault plan (see Lander_Faults.h), call before the
+  first step. The plan isn't copied and has to outlive the swarm.
+*/
+void Swarm_Faults(struct Swarm *s, int i, const struct Fault_Plan *p)
+{
+ s->plan[i] = p;
+ Faults_Start(s, i);
+}
+
+/*
+  Copies lander i's state, controller instance included, into one
+  malloc()ed block. The swarm-wide clock goes with it, so a checkpoint
+  taken between two Swarm_Step()s is the whole world as lander i sees
+  it. Free it with free().
+*/
+struct Swarm_Checkpoint *Swarm_Checkpoint(const struct Swarm *s, int i)
+{
+ struct Swarm_Checkpoint *c = (struct Swarm_Checkpoint *) malloc(sizeof(*c) + s->ctl_size);
+
+ if (!c) return NULL;
+ c->tick = s->tick;
+ c->time = s->time;
+ c->ping = s->ping;
+ c->x = s->x[i]; c->y = s->y[i];
+ c->vx = s->vx[i]; c->vy = s->vy[i];
+ c->angle = s->angle[i]; c->rot = s->rot[i];
+ c->main_p = s->main_p[i]; c->left_p = s->left_p[i]; c->right_p = s->right_p[i];
+ c->ok = s->ok[i];
+ c->plan = s->plan[i];
+ memcpy(c->fault, s->fault + i * FAULT_MAX, sizeof(c->fault));
+ c->fault_next = s->fault_next[i];
+ memcpy(c->fx, s->fx + i * FAULT_COMPS, sizeof(c->fx));
+ memcpy(c->fx_value, s->fx_value + i * FAULT_COMPS, sizeof(c->fx_value));
+ c->status = s->status[i];
+ c->end_tick = s->end_tick[i];
+ c->launch = s->launch[i];
+ memcpy(c->s_dst, s->s_dst + i * SWARM_BEAMS, sizeof(c->s_dst));
+ memcpy(c->s_dir, s->s_dir + i * SWARM_BEAMS, sizeof(c->s_dir));
+ memcpy(c->sonar, s->sonar + i * SWARM_BEAMS, sizeof(c->sonar));
+ c->ctl_size = s->ctl_size;
+ memcpy(c->ctl, s->ctl + i * s->ctl_size, s->ctl_size);
+ return c;
+}
+
+// Puts checkpoint c into lander i, which has to be in a swarm at c's tick
+static void Restore(struct Swarm *s, int i, const struct Swarm_Checkpoint *c)
+{
+ s->x[i] = c->x; s->y[i] = c->y;
+ s->vx[i] = c->vx; s->vy[i] = c->vy;
+ s->angle[i] = c->angle; s->rot[i] = c->rot;
+ sincos(c->angle, &s->sin_a[i], &s->cos_a[i]);
+ s->main_p[i] = c->main_p; s->left_p[i] = c->left_p; s->right_p[i] = c->right_p;
+ s->ok[i] = c->ok;
+ s->plan[i] = c->plan;
+ memcpy(s->fault + i * FAULT_MAX, c->fault, sizeof(c->fault));
+ s->fault_next[i] = c->fault_next;
+ memcpy(s->fx + i * FAULT_COMPS, c->fx, sizeof(c->fx));
+ memcpy(s->fx_value + i * FAULT_COMPS, c->fx_value, sizeof(c->fx_value));
+ s->status[i] = c->status;
+ s->end_tick[i] = c->end_tick;
+ s->launch[i] = c->launch;
+ memcpy(s->s_dst + i * SWARM_BEAMS, c->s_dst, sizeof(c->s_dst));
+ memcpy(s->s_dir + i * SWARM_BEAMS, c->s_dir, sizeof(c->s_dir));
+ memcpy(s->sonar + i * SWARM_BEAMS, c->sonar, sizeof(c->sonar));
+ memcpy(s->ctl + i * s->ctl_size, c->ctl, s->ctl_size);
+}
+
+/*
+  A new swarm of n copies of checkpoint c, in the same world as s: the
+  map, its masks and the hull are shared rather than copied (nothing
+  writes to them) and freed with the last swarm using them. Lander k
+  of the fork draws its noise from stream k of seed, so forks made
+  with the same seed see the same noise lander for lander, and forking
+  with s's seed puts the checkpointed lander's own noise in slot i.
+*/
+struct Swarm *Swarm_Fork(const struct Swarm *s, const struct Swarm_Checkpoint *c, int n, unsigned int seed)
+{
+ struct Swarm *f = (struct Swarm *) calloc(1, sizeof(struct Swarm));
+
+ if (!f) return NULL;
+ if (n < 1 || c->ctl_size != s->ctl_size) {
+  free(f);
+  return NULL;
+ }
+ f->map = s->map;
+ f->mask = s->mask;
+ f->builtin = s->builtin;
+ f->tiles = s->tiles;
+ f->width = s->width;
+ f->height = s->height;
+ f->hull = s->hull;
+ f->plat_x = s->plat_x;
+ f->plat_y = s->plat_y;
+ f->refs = s->refs;
+ ++*f->refs;
+ if (!Alloc_Landers(f, n)) {
+  Swarm_Free(f);
+  return NULL;
+ }
+
+ f->seed = seed;
+ f->tick = c->tick;
+ f->time = c->time;
+ f->ping = c->ping;
+ for (int k = 0; k < n; k++) Restore(f, k, c);
+ return f;
+}
+
+// Lander i's copy of controller global var (any CONTROLLER_STATE variable)
+void *Swarm_State(struct Swarm *s, int i, void *var)
+{
+ return s->ctl + i * s->ctl_size + ((char *) var - __start_lander_state);
+}
+
+static void Ping(struct Swarm *s)
+{
+ for (int i = 0; i < s->n; i++) {
+  double *dir = s->s_dir + i * SWARM_BEAMS, *dst = s->s_dst + i * SWARM_BEAMS;
+
+  if (s->fx[i * FAULT_COMPS + COMP_SONAR] == FAULT_STUCK) continue;	// keeps its last sweep
+  for (int b = 0; b < SWARM_BEAMS; b++) {
+   if (dir[b] == 1) s->sonar[i * SWARM_BEAMS + b] = -1;
+   dir[b] = 1;
+   dst[b] = 15;
+  }
+ }
+}
+
+// Points the controller API at lander i
+void Swarm_Select(struct Swarm *s, int i)
+{
+ cur = s;
+ ci = i;
+ PLAT_X = s->plat_x;
+ PLAT_Y = s->plat_y;
+ MT_OK = !!(s->ok[i] & (1 << COMP_MAIN));
+ LT_OK = !!(s->ok[i] & (1 << COMP_LEFT));
+ RT_OK = !!(s->ok[i] & (1 << COMP_RIGHT));
+ memcpy(SONAR_DIST, s->sonar + i * SWARM_BEAMS, sizeof(SONAR_DIST));
+}
+
+unsigned int Lander_Seed(void)
+{
+ return cur->seed;
+}
+
+unsigned int Lander_Id(void)
+{
+ return ci;
+}
+
+// What the tick does from here on is part, when profiling
+static inline void Part(struct Swarm *s, int part)
+{
+ if (s->perf) Perf_Switch(s->perf, part);
+}
+
+/*
+  Runs lander i's controller instance for one tick. Swapping its state
+  in and out is charged to the controller.
+*/
+static void Control(struct Swarm *s, int i)
+{
+ char *ctl = s->ctl + i * s->ctl_size;
+
+ memcpy(__start_lander_state, ctl, s->ctl_size);
+ if (s->exec) Exec_Control(s, i);
+ else {
+  Lander_Control();
+  Part(s, PERF_SAFETY);
+  Safety_Override();
+  Part(s, PERF_CONTROL);
+ }
+ memcpy(ctl, __start_lander_state, s->ctl_size);
+}
+
+// Advances every lander still flying by one tick, returns how many are left
+int Swarm_Step(struct Swarm *s)
+{
+ int left;
+
+ Part(s, PERF_PHYSICS);
+ Kernel_Physics(s);
+ Part(s, PERF_OTHER);
+ s->tick++;
+ memset(s->draws, 0, s->n * sizeof(*s->draws));
+ s->time += T_STEP;
+ s->ping += T_STEP;
+ if (s->ping > .25) {
+  s->ping = 0;
+  Ping(s);
+ }
+ Faults_Tick(s);
+
+ Part(s, PERF_CONTROL);
+ if (s->exchange) s->exchange(s);
+ for (int i = 0; i < s->n; i++)
+  if (!s->status[i]) {
+   Swarm_Select(s, i);
+   if (s->pilot) s->pilot(s, i);
+   else Control(s, i);
+  }
+
+ Part(s, PERF_SONAR);
+ Kernel_Sonar(s);
+ Part(s, PERF_COLLIDE);
+ left = Kernel_Collide(s);
+ if (s->trace) {
+  Part(s, PERF_TRACE);
+  Trace_Record(s->trace, s, !left);
+ }
+ Part(s, PERF_OTHER);
+ return left;
+}
+
+// Gives up on whoever is still flying
+void Swarm_Finish(struct Swarm *s)
+{
+ for (int i = 0; i < s->n; i++)
+  if (!s->status[i]) {
+   s->status[i] = SWARM_TIMEOUT;
+   s->end_tick[i] = s->tick;
+  }
+ if (s->trace) Trace_Record(s->trace, s, 1);
+}
+
+/*
+  The controller API, answering for lander ci with the simulator's
+  noise model.
+*/
+static double Power(int comp, int ch, double p)
+{
+ int fx = cur->fx[ci * FAULT_COMPS + comp];
+ double fv = cur->fx_value[ci * FAULT_COMPS + comp];
+
+ if (!(cur->ok[ci] & (1 << comp))) return 0;
+ if (fx == FAULT_STUCK) return fv;
+ p = (p < 0 ? 0 : p > 1 ? .95 : .95 * p) + .05 * U(ci, ch) * (fx == FAULT_NOISY ? fv : 1);
+ return fx == FAULT_BIAS ? fmax(0, p + fv) : p;
+}
+
+void Main_Thruster(double power)
+{
+ cur->main_p[ci] = Power(COMP_MAIN, RNG_MAIN, power);
+}
+
+void Left_Thruster(double power)
+{
+ cur->left_p[ci] = Power(COMP_LEFT, RNG_LEFT, power);
+}
+
+void Right_Thruster(double power)
+{
+ cur->right_p[ci] = Power(COMP_RIGHT, RNG_RIGHT, power);
+}
+
+void Rotate(double angle)
+{
+ cur->rot[ci] = (.95 * angle + .05 * U(ci, RNG_ROTATE)) * PI / 180;
+}
+
+/*
+  v plus amp * (U - .5) of noise, through whatever fault the sensor
+  has. A dead sensor reads uniformly from [lo, lo + span).
+*/
+static double Sensor(int comp, int ch, double v, double amp, double lo, double span)
+{
+ int fx = cur->fx[ci * FAULT_COMPS + comp];
+ double fv = cur->fx_value[ci * FAULT_COMPS + comp];
+
+ if (!(cur->ok[ci] & (1 << comp))) return lo + span * U(ci, ch);
+ if (fx == FAULT_STUCK) return fv;
+ v += amp * (fx == FAULT_NOISY ? fv : 1) * (U(ci, ch) - .5);
+ return fx == FAULT_BIAS ? v + fv : v;
+}
+
+double Velocity_X(void)
+{
+ return Sensor(COMP_VX, RNG_VX, cur->vx[ci], cur->vx[ci] * NP1, -25, 50);
+}
+
+double Velocity_Y(void)
+{
+ return Sensor(COMP_VY, RNG_VY, cur->vy[ci], cur->vy[ci] * NP1, -25, 50);
+}
+
+/*
+  The simulator's position noise grows with x, up to 5% at the right
+  edge of its 1024 pixels. A wider world keeps it at that past x =
+  1024, or a lander 14000 pixels across would read its position 350
+  pixels either way.
+*/
+static double Noise_X(void)
+{
+ return cur->tiles ? fmin(cur->x[ci], SWARM_MAP_SIZE) : cur->x[ci];
+}
+
+double Position_X(void)
+{
+ return Sensor(COMP_PX, RNG_PX, cur->x[ci], Noise_X() * NP1, 0, cur->width);
+}
+
+// The simulator scales the noise on Y by X, and so do we
+double Position_Y(void)
+{
+ return Sensor(COMP_PY, RNG_PY, cur->y[ci], Noise_X() * NP2, 0, cur->height);
+}
+
+// A dead angle sensor isn't uniform, it's the real angle +/- 1.25 radians
+double Angle(void)
+{
+ double a = cur->angle[ci];
+
+ if (!(cur->ok[ci] & (1 << COMP_ANGLE))) return (a + 2.5 * U(ci, RNG_ANGLE) - 1.25) * 180 / PI;
+ return Sensor(COMP_ANGLE, RNG_ANGLE, a * 180 / PI, .05 * 180 / PI, 0, 0);
+}
+
+// Last step along the ray from (x, y) by (dx, dy) still rounding into [lo, lo + size)
+static int Block_Exit(double x, double dx, int lo, int size)
+{
+ double edge = dx > 0 ? lo + size - .5 : lo - .5;
+
+ if (fabs(dx) < 1e-9) return SWARM_MAP_SIZE;
+ return (int) ceil((edge - x) / dx - 1e-7) - 1;
+}
+
+// The same over a tiled world, where the blocks crossed in one go are empty tiles
+static double Range_Tiles(double x, double y, double sa, double ca)
+{
+ const struct Tile_Map *t = cur->tiles;
+
+ for (int i = 0; i < SWARM_MAP_SIZE; i++) {
+  int px = (int) round(x - i * sa), py = (int) round(y + i * ca);
+  if (px < 0 || px >= cur->width || py < 0 || py >= cur->height) continue;
+  if (Tile_Map_Empty(t, px, py, px, py)) {
+   int bx = px - px % TILE_SIZE, by = py - py % TILE_SIZE;
+   int j = fmin(Block_Exit(x, -sa, bx, TILE_SIZE), Block_Exit(y, ca, by, TILE_SIZE));
+   if (j > i) i = j;
+   continue;
+  }
+  if (Tile_Map_Solid(t, px, py)) return i - 19;
+ }
+ return -1;
+}
+
+// Pixel by pixel as the simulator does it, but empty 16x16 blocks are crossed in one go
+double RangeDist(void)
+{
+ const struct Terrain_Mask *m = cur->mask;
+ double sa, ca, x = cur->x[ci], y = cur->y[ci];
+
+ sincos(cur->angle[ci], &sa, &ca);
+ if (cur->tiles) return Range_Tiles(x, y, sa, ca);
+ for (int i = 0; i < SWARM_MAP_SIZE; i++) {
+  int px = (int) round(x - i * sa), py = (int) round(y + i * ca);
+  if (px < 0 || px >= SWARM_MAP_SIZE || py < 0 || py >= SWARM_MAP_SIZE) continue;
+  if (!(m->blocks[py >> BLOCK_SHIFT] & (1ULL << (px >> BLOCK_SHIFT)))) {
+   int bx = px & ~(BLOCK_SIZE - 1), by = py & ~(BLOCK_SIZE - 1);
+   int j = fmin(Block_Exit(x, -sa, bx, BLOCK_SIZE), Block_Exit(y, ca, by, BLOCK_SIZE));
+   if (j > i) i = j;	// nothing lit before step j + 1
+   continue;
+  }
+  if (cur->map[3 * (py * SWARM_MAP_SIZE + px)] > 5) return i - 19;
+ }
+ return -1;
+}
+
+/*
+  Sensors_Oversample()'s averaging, without going through the API once
+  per sample. A working sensor's mean is the true value plus the mean
+  of its noise, and the noise draws come out of the RNG in one batch.
+  Failed or faulty sensors take the long way round.
+*/
+double Sensor_Mean(int sensor, int n)
+{
+ static const int comps[SENSORS] = {COMP_VX, COMP_VY, COMP_PX, COMP_PY, COMP_ANGLE};
+ static const int channels[SENSORS] = {RNG_VX, RNG_VY, RNG_PX, RNG_PY, RNG_ANGLE};
+ int comp = comps[sensor], ch = channels[sensor];
+ double u[64], sum = 0, v, amp;
+
+ if (!(cur->ok[ci] & (1 << comp)) || cur->fx[ci * FAULT_COMPS + comp])
+  return Sensor_Mean_Sampled(sensor, n);
+
+ for (int done = 0; done < n; done += 64) {
+  int m = n - done < 64 ? n - done : 64;
+  Rng_Draws(cur->seed, ci, cur->tick, ch, cur->draws[ci][ch], m, u);
+  cur->draws[ci][ch] += m;
+  for (int k = 0; k < m; k++) sum += u[k];
+ }
+
+ switch (sensor) {
+  case SENSOR_VX: v = cur->vx[ci]; amp = v * NP1; break;
+  case SENSOR_VY: v = cur->vy[ci]; amp = v * NP1; break;
+  case SENSOR_PX: v = cur->x[ci]; amp = Noise_X() * NP1; break;
+  case SENSOR_PY: v = cur->y[ci]; amp = Noise_X() * NP2; break;
+  default: v = cur->angle[ci] * 180 / PI; amp = .05 * 180 / PI;
+ }
+ v += amp * (sum / n - .5);
+ return sensor == SENSOR_ANGLE ? fmod(v + 360.0, 360.0) : v;
+}
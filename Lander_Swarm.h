@@ -0,0 +1,164 @@
+#ifndef _LANDER_SWARM_H
+#define _LANDER_SWARM_H
+
+/*
+  Many landers flying in one world.
+
+  The simulator in Lander_Control.o flies a single lander, so testing
+  the controllers against hundreds of starting positions and failure
+  sets means hundreds of processes, each loading and scanning its own
+  copy of the map. A swarm loads the map once and steps every lander
+  together, with the dynamics, sensors and failure injection of the
+  simulator re-implemented over per-lander arrays (one array per
+  quantity, so each stage of a tick is a loop down contiguous memory).
+
+  Each lander also gets its own controller instance: the controllers'
+  globals live in one linker section (see Lander_State.h) which is
+  swapped per lander around Lander_Control()/Safety_Override(). The
+  controller API (Lander_Control.h) is provided here and answers for
+  whichever lander is being controlled. The batched stages of a tick
+  are in Lander_Kernel.cpp.
+
+  No graphics, no timing: a swarm runs as fast as it can, unless it's
+  run by the executive in Lander_Exec.h.
+
+  Swarm_Checkpoint() takes a lander mid-flight, controller and all, and
+  Swarm_Fork() starts a new swarm of copies of it that fly on from
+  there, for asking "what if" from the middle of a descent without
+  flying the first part again. Between the two, a fork's landers can
+  be given their own fault plans (Swarm_Faults(), onset times still
+  count from the start of the flight, and the plan replaces the one
+  inherited) or controller settings (Swarm_State()).
+
+  A pilot function, if set, flies every lander in place of the
+  controllers. It's called with the controller API already pointing
+  at the lander (Swarm_Select()) and commands it through the same
+  calls, noise and failures included; see Lander_Env.h. A pilot that
+  works on all the landers at once (Lander_Link.h) gets a call to
+  exchange first.
+
+  The world is normally the simulator's 1024x1024 image. A tiled world
+  ('tmap:world.tmap', see Terrain_Tiles.h) is flown whole instead, at
+  whatever size it was built: the landers start spread across its
+  width, and collisions, sonar and RangeDist() read the tiles around
+  each lander instead of a mask of the image. ('tmap:world.tmap@x,y'
+  is still the 1024x1024 window readPPMimage() cuts out of it.)
+*/
+
+#include <stddef.h>
+
+#include "Lander_Faults.h"
+#include "Lander_Rng.h"
+
+struct Terrain_Mask;
+struct Tile_Map;
+struct Exec;
+struct Trace;
+struct Perf;
+
+#define SWARM_MAP_SIZE 1024
+#define SWARM_BEAMS 36
+
+// Lander status, the same outcomes the simulator prints
+#define SWARM_FLYING 0
+#define SWARM_CRASHED 1
+#define SWARM_LANDED 2
+#define SWARM_LOST 3		// left the map
+#define SWARM_TIMEOUT 4		// still flying when Swarm_Finish() was called
+
+// Failure modes, as on the simulator's command line (see Fault_Mode())
+#define FAIL_NONE 0
+#define FAIL_THRUSTER 1		// one thruster at a random time in 0-4s, another in 0-8s
+#define FAIL_RANDOM 2		// same, but any of components 1-8
+#define FAIL_LIST 3		// the given components at 0.5s
+
+// Components, bit c of a lander's ok mask
+#define COMP_MAIN 1
+#define COMP_LEFT 2
+#define COMP_RIGHT 3
+#define COMP_VX 4
+#define COMP_VY 5
+#define COMP_PX 6
+#define COMP_PY 7
+#define COMP_ANGLE 8
+#define COMP_SONAR 9
+#define COMP_ALL 0x3fe
+
+struct Swarm {
+ int n;
+ long tick;
+ double time;
+ double ping;			// time since the last sonar ping, everyone pings together
+
+ const unsigned char *map;	// 1024x1024 RGB, shared by all
+ int *refs;			// swarms sharing map, mask, tiles and hull (see Swarm_Fork())
+ const struct Terrain_Mask *mask;	// the same as bits (see Lander_Kernel.h)
+ int builtin;			// map and mask are built into the program (Lander_Assets.h)
+ struct Tile_Map *tiles;	// a tiled world in place of map and mask, if set
+ int width, height;		// of the world, in pixels
+ double plat_x, plat_y;
+ unsigned long long *hull;	// lander.ppm's 64 rows, bit c set if column c is solid
+
+ // Per lander state
+ double *x, *y;			// map pixels, y grows downward
+ double *vx, *vy;		// vy is positive going up
+ double *angle;			// radians, 0 - 2*PI
+ double *sin_a, *cos_a;		// of angle
+ double *rot;			// rotation left to do (radians)
+ double *main_p, *left_p, *right_p;	// 0 once the thruster fails
+ int *ok;			// bit COMP_x set while component x works
+ const struct Fault_Plan **plan;	// see Lander_Faults.h
+ struct Fault_State *fault;	// FAULT_MAX per lander
+ long *fault_next;		// tick of the lander's next fault event
+ unsigned char *fx;		// FAULT_STUCK/BIAS/NOISY per component, 0 if reading normally
+ double *fx_value;		// and the fault's value
+ int *status;
+ long *end_tick;		// tick the lander finished on
+ long *launch;			// tick its flight started on (see Swarm_Reset())
+ double *s_dst, *s_dir;		// sonar wavefront, SWARM_BEAMS per lander
+ double *sonar;			// what SONAR_DIST reads for each lander
+ unsigned int seed;
+ unsigned short (*draws)[RNG_CHANNELS];	// numbers taken per Lander_Rng.h channel this tick
+
+ size_t ctl_size;
+ char *ctl;			// saved controller instances, ctl_size bytes each
+
+ struct Exec *exec;		// times the controllers if set (see Lander_Exec.h)
+ void (*pilot)(struct Swarm *s, int i);	// flies the landers instead of the controllers if set
+ void (*exchange)(struct Swarm *s);	// called once a tick before the pilot, if set
+ void *pilot_arg;		// for the pilot's use
+ struct Trace *trace;		// records the flights if set (see Lander_Trace.h)
+ struct Perf *perf;		// profiles the ticks if set (see Lander_Perf.h)
+};
+
+// One lander's state as a flat block, the controller instance at the end
+struct Swarm_Checkpoint {
+ long tick;
+ double time, ping;
+ double x, y, vx, vy, angle, rot;
+ double main_p, left_p, right_p;
+ int ok;
+ const struct Fault_Plan *plan;
+ struct Fault_State fault[FAULT_MAX];
+ long fault_next;
+ unsigned char fx[FAULT_COMPS];
+ double fx_value[FAULT_COMPS];
+ int status;
+ long end_tick, launch;
+ double s_dst[SWARM_BEAMS], s_dir[SWARM_BEAMS], sonar[SWARM_BEAMS];
+ size_t ctl_size;
+ char ctl[];
+};
+
+struct Swarm *Swarm_Create(const char *map, int n, unsigned int seed);
+void Swarm_Free(struct Swarm *s);
+void Swarm_Faults(struct Swarm *s, int i, const struct Fault_Plan *p);
+void Swarm_Reset(struct Swarm *s, int i);
+void Swarm_Select(struct Swarm *s, int i);
+int Swarm_Step(struct Swarm *s);
+void Swarm_Finish(struct Swarm *s);
+struct Swarm_Checkpoint *Swarm_Checkpoint(const struct Swarm *s, int i);
+struct Swarm *Swarm_Fork(const struct Swarm *s, const struct Swarm_Checkpoint *c, int n, unsigned int seed);
+void *Swarm_State(struct Swarm *s, int i, void *var);
+
+#endif
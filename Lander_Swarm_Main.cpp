@@ -0,0 +1,234 @@
+/*
+	Command line front end for the multi-lander simulation.
+
+	Usage: Lander_Swarm [-s seed] [-t seconds] [-k seconds] [-f plan] [-F faults] [-T trace] [-P]
+	                    [-x ms [-X] [-p]] [-R client [-w seconds]] map landers FailMode [components]...
+
+	e.g.   Lander_Swarm easy.ppm 500 0
+	       Lander_Swarm -s 7 gen:cave:42 200 1
+	       Lander_Swarm hard.ppm 300 3 2 6
+	       Lander_Swarm -F 'main dead at=1 when=rotating' hard.ppm 300 0
+	       Lander_Swarm -x 5 -p hard.ppm 1 1
+	       Lander_Swarm -k 6 -F 'right dead at=6' hard.ppm 1000 0
+	       Lander_Swarm -R ./Lander_Client hard.ppm 300 1
+	       Lander_Swarm -T sweep.trace hard.ppm 300 2
+	       Lander_Swarm -P hard.ppm 300 1
+
+	map, FailMode and the component list mean the same as for
+	Lander_Control, except that every lander draws its own failures.
+	-f reads a fault plan from a file, -F takes one on the command line
+	(see Lander_Faults.h), both add to what FailMode injects. Landers
+	still flying after -t simulated seconds (default 120) are counted
+	as timed out.
+
+	-k flies a single lander, with no failures, for the given simulated
+	seconds and then forks it into all the landers (Swarm_Fork()),
+	which fly on from there with their own noise and the failures
+	asked for. Onset times still count from the start of the flight,
+	anything due before the fork happens at the fork. The first of the
+	forks has the noise the lander would have had anyway.
+
+	-R starts the given program (normally Lander_Client) with the name
+	of a shared memory link and has it fly the landers from its own
+	process (Lander_Link.h). A client that takes longer than -w seconds
+	(default 1) over a tick, or dies, is cut off and its landers fly on
+	with their last commands.
+
+	-T records every lander's flight in a trace file for Lander_Render
+	(see Lander_Trace.h). With -k it starts at the fork.
+
+	-P profiles the run with the CPU's counters (Lander_Perf.h) and
+	reports cycles, IPC, cache and branch misses for the controllers,
+	Safety_Override(), physics, sonar, collision and the trace. With -k
+	it starts at the fork. With -R the controllers are in the client,
+	so control is just the wait for it.
+
+	-x runs the swarm under the real-time executive (Lander_Exec.h)
+	with a budget of ms milliseconds per lander per tick (T_STEP is
+	5). Overrunning ticks hold the last commands, or with -X cut the
+	thrusters. -p paces ticks T_STEP apart in real time, which only
+	makes sense for a lander or a few.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <iostream>
+
+#include "Lander_Control.h"
+#include "Lander_Exec.h"
+#include "Lander_Faults.h"
+#include "Lander_Link.h"
+#include "Lander_Perf.h"
+#include "Lander_Swarm.h"
+#include "Lander_Trace.h"
+
+static const char *outcome[] = {"flying", "crashed", "landed", "lost", "timed out"};
+
+// Control task costs against the budget, over all landers
+static void Exec_Report(const struct Exec *e, int n)
+{
+ long tasks = 0, overruns = 0, worst = 0;
+ double sum = 0, max = 0, control = 0, safety = 0;
+
+ for (int i = 0; i < n; i++) {
+  tasks += e->tasks[i];
+  overruns += e->overruns[i];
+  sum += e->cost_sum[i];
+  if (e->overruns[i]) worst++;
+  if (e->cost_max[i] > max) max = e->cost_max[i];
+  if (e->control_max[i] > control) control = e->control_max[i];
+  if (e->safety_max[i] > safety) safety = e->safety_max[i];
+ }
+ printf("executive: %s, %s, budget %.3fms, overruns %s\n", !e->paced ? "unpaced" : e->fifo ? "paced at SCHED_FIFO" : "paced (SCHED_FIFO not allowed)",
+        e->cpu >= 0 ? "pinned" : "not pinned", e->budget * 1000, e->on_overrun == EXEC_SAFE ? "cut thrust" : "hold");
+ printf("  control tasks %ld, mean %.1fus, worst %.1fus (Lander_Control %.1fus, Safety_Override %.1fus)\n",
+        tasks, tasks ? sum / tasks * 1e6 : 0, max * 1e6, control * 1e6, safety * 1e6);
+ printf("  overruns %ld (%.3f%%) on %ld landers\n", overruns, tasks ? 100.0 * overruns / tasks : 0, worst);
+ if (e->paced)
+  printf("  releases %ld, jitter mean %.1fus, worst %.1fus, %ld late by a tick or more\n", e->releases,
+         e->releases ? e->jitter_sum / e->releases * 1e6 : 0, e->jitter_max * 1e6, e->late);
+}
+
+int main(int argc, char *argv[])
+{
+ struct Swarm *s;
+ unsigned int seed = time(NULL);
+ double limit = 120, land_time = 0, budget = 0, fork_at = 0;
+ long start_tick = 0;
+ int opt, n, mode, set = 0, count[5] = {0}, on_overrun = EXEC_HOLD, paced = 0, profile = 0;
+ struct timespec t0, t1;
+ double wall;
+ static struct Fault_Plan plan;
+ const char *plan_file = NULL, *faults = NULL, *client = NULL, *trace = NULL;
+ char link_name[64];
+ static struct Link_Server srv;
+
+ srv.timeout = 1;
+ while ((opt = getopt(argc, argv, "s:t:k:f:F:T:Px:XpR:w:")) != -1) {
+  if (opt == 's') seed = strtoul(optarg, NULL, 10);
+  else if (opt == 'x') budget = atof(optarg) / 1000;
+  else if (opt == 'X') on_overrun = EXEC_SAFE;
+  else if (opt == 'p') paced = 1;
+  else if (opt == 'R') client = optarg;
+  else if (opt == 'w') srv.timeout = atof(optarg);
+  else if (opt == 't') limit = atof(optarg);
+  else if (opt == 'k') fork_at = atof(optarg);
+  else if (opt == 'f') plan_file = optarg;
+  else if (opt == 'F') faults = optarg;
+  else if (opt == 'T') trace = optarg;
+  else if (opt == 'P') profile = 1;
+  else break;
+ }
+ if (argc - optind < 3) {
+  fprintf(stderr, "Usage: Lander_Swarm [-s seed] [-t seconds] [-k seconds] [-f plan] [-F faults] [-T trace] [-P]\n"
+                  "                    [-x ms [-X] [-p]] [-R client [-w seconds]] map landers FailMode [components]...\n");
+  return 1;
+ }
+ n = atoi(argv[optind + 1]);
+ mode = atoi(argv[optind + 2]);
+ for (int i = optind + 3; i < argc; i++) {
+  int c = atoi(argv[i]);
+  if (c >= 1 && c <= 9) set |= 1 << c;
+ }
+ if (mode == FAIL_LIST && !set) {
+  fprintf(stderr, "Failure mode 3 needs a list of components\n");
+  return 1;
+ }
+ if (!Fault_Mode(mode, set, &plan) || (plan_file && !Fault_Load(plan_file, &plan)) ||
+     (faults && !Fault_Parse(faults, &plan)))
+  return 1;
+
+ // The controllers print to cout every tick, times a few hundred landers
+ std::cout.setstate(std::ios::badbit);
+
+ s = Swarm_Create(argv[optind], fork_at > 0 ? 1 : n, seed);
+ if (!s) {
+  fprintf(stderr, "Unable to set up %d landers on %s\n", n, argv[optind]);
+  return 1;
+ }
+ if (fork_at > 0) {
+  struct Swarm *base = s;
+  struct Swarm_Checkpoint *c;
+
+  while (Swarm_Step(base) && base->time < fork_at);
+  if (base->status[0]) {
+   fprintf(stderr, "The lander was down before %.2fs, nothing to fork\n", fork_at);
+   return 1;
+  }
+  c = Swarm_Checkpoint(base, 0);
+  s = c ? Swarm_Fork(base, c, n, seed) : NULL;
+  if (!s) {
+   fprintf(stderr, "Out of memory\n");
+   return 1;
+  }
+  start_tick = s->tick;
+  free(c);
+  Swarm_Free(base);
+ }
+ for (int i = 0; i < n; i++) Swarm_Faults(s, i, &plan);
+ if (client) {
+  snprintf(link_name, sizeof(link_name), "/lander_swarm_%d", (int) getpid());
+  if (!(srv.link = Link_Create(link_name, n))) {
+   fprintf(stderr, "Unable to set up a link for %d landers\n", n);
+   return 1;
+  }
+  if (!Link_Serve(s, &srv, link_name, client)) {
+   fprintf(stderr, "%s never attached to the link\n", client);
+   Link_Close(srv.link, link_name, 1);
+   return 1;
+  }
+ }
+ if (trace && !(s->trace = Trace_Create(trace, s, argv[optind]))) {
+  perror(trace);
+  return 1;
+ }
+ if (budget > 0 && !(s->exec = Exec_Create(n, budget, on_overrun, paced))) {
+  fprintf(stderr, "Out of memory\n");
+  return 1;
+ }
+ if (profile && !(s->perf = Perf_Create())) {
+  fprintf(stderr, "Out of memory\n");
+  return 1;
+ }
+
+ clock_gettime(CLOCK_MONOTONIC, &t0);
+ if (s->exec) Exec_Run(s, limit);
+ else while (Swarm_Step(s) && s->time < limit);
+ Swarm_Finish(s);
+ clock_gettime(CLOCK_MONOTONIC, &t1);
+ if (s->perf) Perf_Stop(s->perf);
+ if (client) Link_Finish(&srv);
+ if (s->trace && !Trace_Close(s->trace)) fprintf(stderr, "%s: write failed, the trace is short\n", trace);
+ wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+
+ long lander_ticks = 0;
+ for (int i = 0; i < n; i++) {
+  count[s->status[i]]++;
+  lander_ticks += s->end_tick[i] - start_tick;
+  if (s->status[i] == SWARM_LANDED) land_time += s->end_tick[i] * T_STEP;
+ }
+
+ printf("%d landers, seed %u, platform at (%.1f, %.1f)\n", n, seed, s->plat_x, s->plat_y);
+ if (start_tick)
+  printf("  forked at %.2fs\n", start_tick * T_STEP);
+ for (int k = SWARM_CRASHED; k <= SWARM_TIMEOUT; k++)
+  printf("  %-10s %5d (%.1f%%)\n", outcome[k], count[k], 100.0 * count[k] / n);
+ if (count[SWARM_LANDED])
+  printf("  mean time to land %.2fs\n", land_time / count[SWARM_LANDED]);
+ printf("%ld lander ticks in %.2fs (%.0f per second)\n", lander_ticks, wall, lander_ticks / wall);
+ if (s->exec) Exec_Report(s->exec, n);
+ if (s->perf) Perf_Report(s->perf, stdout);
+ if (client) {
+  printf("link: %ld ticks through %s, round trip mean %.1fus, worst %.1fus\n", srv.exchanges, client,
+         srv.exchanges ? srv.wait_sum / srv.exchanges * 1e6 : 0, srv.wait_max * 1e6);
+  if (srv.lost) printf("  client cut off at %.3fs\n", srv.lost_tick * T_STEP);
+  Link_Close(srv.link, link_name, 1);
+ }
+
+ Exec_Free(s->exec);
+ Perf_Free(s->perf);
+ Swarm_Free(s);
+ return 0;
+}
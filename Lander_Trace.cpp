@@ -0,0 +1,143 @@
+/*
+	Flight traces (see Lander_Trace.h).
+*/
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Lander_Trace.h"
+
+// The tick, then the landers, rounded up so every frame's tick is aligned
+size_t Trace_Frame_Size(int n)
+{
+ return (sizeof(long) + n * sizeof(struct Trace_Lander) + 7) & ~(size_t) 7;
+}
+
+static unsigned char Power(double p)
+{
+ return (unsigned char) lrint(fmax(0, fmin(p, 1)) * 255);
+}
+
+/*
+  Starts a trace of swarm s in filename, with s as it is now as the
+  first frame. map is recorded for the renderer.
+*/
+struct Trace *Trace_Create(const char *filename, const struct Swarm *s, const char *map)
+{
+ struct Trace *t = (struct Trace *) calloc(1, sizeof(struct Trace));
+ struct Trace_Head h;
+
+ if (!t) return NULL;
+ t->buf = (char *) calloc(1, Trace_Frame_Size(s->n));
+ t->f = fopen(filename, "wb");
+ if (!t->buf || !t->f) {
+  if (t->f) fclose(t->f);
+  free(t->buf);
+  free(t);
+  return NULL;
+ }
+ memset(&h, 0, sizeof(h));
+ memcpy(h.magic, TRACE_MAGIC, 4);
+ h.version = TRACE_VERSION;
+ h.n = t->n = s->n;
+ h.every = t->every = TRACE_EVERY;
+ h.plat_x = s->plat_x;
+ h.plat_y = s->plat_y;
+ snprintf(h.map, sizeof(h.map), "%s", map);
+ fwrite(&h, sizeof(h), 1, t->f);
+ t->last = -1;
+ Trace_Record(t, s, 1);
+ return t;
+}
+
+// Writes a frame if one is due this tick, or regardless with force (unless it's already written)
+void Trace_Record(struct Trace *t, const struct Swarm *s, int force)
+{
+ long *tick = (long *) t->buf;
+ struct Trace_Lander *l = (struct Trace_Lander *) (tick + 1);
+
+ if (s->tick == t->last || (!force && s->tick % t->every)) return;
+ t->last = *tick = s->tick;
+ for (int i = 0; i < t->n; i++, l++) {
+  const double *sonar = s->sonar + i * SWARM_BEAMS;
+
+  l->x = s->x[i];
+  l->y = s->y[i];
+  l->vx = s->vx[i];
+  l->vy = s->vy[i];
+  l->angle = s->angle[i];
+  l->ok = s->ok[i];
+  l->status = s->status[i];
+  l->main = Power(s->main_p[i]);
+  l->left = Power(s->left_p[i]);
+  l->right = Power(s->right_p[i]);
+  for (int b = 0; b < SWARM_BEAMS; b++) l->sonar[b] = sonar[b] < 0 ? -1 : (short) fmin(sonar[b], 32767);
+ }
+ fwrite(t->buf, Trace_Frame_Size(t->n), 1, t->f);
+}
+
+// Returns 0 if anything failed to make it to the file
+int Trace_Close(struct Trace *t)
+{
+ int ok = !ferror(t->f);
+
+ ok = !fclose(t->f) && ok;
+ free(t->buf);
+ free(t);
+ return ok;
+}
+
+struct Trace_File *Trace_Map(const char *filename)
+{
+ struct Trace_File *t;
+ struct stat st;
+ void *p;
+ int fd = open(filename, O_RDONLY);
+
+ if (fd < 0) return NULL;
+ if (fstat(fd, &st) || (size_t) st.st_size < sizeof(struct Trace_Head)) {
+  close(fd);
+  return NULL;
+ }
+ p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+ close(fd);
+ if (p == MAP_FAILED) return NULL;
+ t = (struct Trace_File *) malloc(sizeof(struct Trace_File));
+ if (!t || memcmp(p, TRACE_MAGIC, 4) || ((struct Trace_Head *) p)->version != TRACE_VERSION ||
+     ((struct Trace_Head *) p)->n < 1) {
+  munmap(p, st.st_size);
+  free(t);
+  return NULL;
+ }
+ t->head = (const struct Trace_Head *) p;
+ t->size = st.st_size;
+ t->frames = (t->size - sizeof(struct Trace_Head)) / Trace_Frame_Size(t->head->n);
+ return t;
+}
+
+void Trace_Unmap(struct Trace_File *t)
+{
+ munmap((void *) t->head, t->size);
+ free(t);
+}
+
+static const char *Frame(const struct Trace_File *t, int frame)
+{
+ return (const char *) (t->head + 1) + frame * Trace_Frame_Size(t->head->n);
+}
+
+long Trace_Tick(const struct Trace_File *t, int frame)
+{
+ return *(const long *) Frame(t, frame);
+}
+
+// Lander i in the given frame
+const struct Trace_Lander *Trace_At(const struct Trace_File *t, int frame, int i)
+{
+ return (const struct Trace_Lander *) (Frame(t, frame) + sizeof(long)) + i;
+}
@@ -0,0 +1,71 @@
+#ifndef _LANDER_TRACE_H
+#define _LANDER_TRACE_H
+
+/*
+  Flight traces, for looking at a swarm's flights after the fact.
+
+  A swarm with a trace (Lander_Swarm -T) writes every lander's state
+  to it every TRACE_EVERY ticks, from its first tick (or the fork) to
+  the last, and Lander_Render turns that into frames offline, in
+  parallel and without simulating anything.
+
+  The file is a Trace_Head followed by fixed size frames: the tick,
+  then a Trace_Lander per lander. Frame f of a trace with n landers is
+  at sizeof(Trace_Head) + f * Trace_Frame_Size(n), so a reader can
+  mmap it and go straight to any frame. A trace cut short by a run
+  that died just has fewer frames. It's written and read on the same
+  machine, nothing is byte swapped.
+*/
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "Lander_Swarm.h"
+
+#define TRACE_MAGIC "LTRC"
+#define TRACE_VERSION 1
+#define TRACE_EVERY 8		// ticks per frame, 25 frames a second
+
+struct Trace_Head {
+ char magic[4];
+ int version;
+ int n;			// landers in each frame
+ int every;		// ticks between frames
+ double plat_x, plat_y;
+ char map[256];		// as given to Swarm_Create()
+};
+
+struct Trace_Lander {
+ float x, y, vx, vy, angle;
+ unsigned short ok;			// the lander's component bits
+ unsigned char status;			// SWARM_x
+ unsigned char main, left, right;	// thruster power, 255 is full
+ short sonar[SWARM_BEAMS];		// pixels, -1 for no return
+};
+
+// Writing
+struct Trace {
+ FILE *f;
+ int n, every;
+ long last;		// tick of the last frame written
+ char *buf;		// a frame
+};
+
+struct Trace *Trace_Create(const char *filename, const struct Swarm *s, const char *map);
+void Trace_Record(struct Trace *t, const struct Swarm *s, int force);
+int Trace_Close(struct Trace *t);
+
+// Reading
+struct Trace_File {
+ const struct Trace_Head *head;
+ int frames;
+ size_t size;
+};
+
+size_t Trace_Frame_Size(int n);
+struct Trace_File *Trace_Map(const char *filename);
+void Trace_Unmap(struct Trace_File *t);
+long Trace_Tick(const struct Trace_File *t, int frame);
+const struct Trace_Lander *Trace_At(const struct Trace_File *t, int frame, int i);
+
+#endif
@@ -0,0 +1,109 @@
+/*
+	Thrust while turning (see Lander_Turn.h).
+
+	Rotate() takes effect on the next simulation step, and each step
+	turns the lander before it applies the thrust, so powers set on
+	the k-th tick after Turn_Plan() push along the angle reached after
+	k + 1 steps of MAX_ROT_RATE.
+*/
+
+#include <math.h>
+
+#include "Lander_Bus.h"
+#include "Lander_Control.h"
+#include "Lander_Events.h"
+#include "Lander_Sensors.h"
+#include "Lander_State.h"
+#include "Lander_Turn.h"
+
+CONTROLLER_STATE static int turning = 0;
+CONTROLLER_STATE static double turn_from;	// degrees
+CONTROLLER_STATE static double turn_delta;	// degrees, + is clockwise
+CONTROLLER_STATE static long turn_tick;		// tick Rotate() was called on
+CONTROLLER_STATE static double turn_vx;		// m/s, Sensed_VX() when planned, carried on since
+CONTROLLER_STATE static double turn_ax;		// m/s^2 sideways from the last Turn_Thrust()
+CONTROLLER_STATE static long thrust_tick;	// tick of the last Turn_Thrust()
+
+#define TURN_DRIFT_TIME .5	// seconds the profile takes drift out over
+#define TURN_DRIFT_MAX 4.0	// m/s^2 at most spent on it
+
+// Called with the Rotate() just issued, from the angle it was issued at
+void Turn_Plan(double from, double delta)
+{
+ turning = 1;
+ turn_from = from;
+ turn_delta = delta;
+ turn_tick = Events_Ticks();
+ turn_vx = Sensed_VX();
+ turn_ax = 0;
+ thrust_tick = turn_tick;
+}
+
+// Rotate() to angle degrees from vertical, clockwise, the short way round
+void Turn_To(double angle)
+{
+ double from = Sensed_Angle();
+ double delta = (fabs(from - angle) > 180.0) ? (((angle - from) > 0.0) ? -(360.0 - (angle - from)) : (360.0 + (angle - from))) : -(from - angle);
+
+ Bus_Rotate(delta);
+ Turn_Plan(from, delta);
+}
+
+// Where the lander will point for the thrust set on this tick
+double Turn_Angle(void)
+{
+ double steps = Events_Ticks() - turn_tick + 1;
+ double swept = fmin(steps * MAX_ROT_RATE * 180 / PI, fabs(turn_delta));
+ double a = fmod(turn_from + (turn_delta < 0 ? -swept : swept), 360.0);
+
+ return a < 0 ? a + 360 : a;
+}
+
+// Should have got there a while ago, something else has had the lander
+// turning (Safety_Override() for one)
+int Turn_Overdue(void)
+{
+ double steps = Events_Ticks() - turn_tick + 1;
+
+ return turning && steps * MAX_ROT_RATE * 180 / PI > fabs(turn_delta) + 30;
+}
+
+/*
+  Splits what's wanted, G_ACCEL up and enough sideways to take the
+  drift out over TURN_DRIFT_TIME, over the main thruster's direction
+  and the left/right thrusters' axis, which are at right angles, and
+  gives each working thruster its share. Anything a thruster would
+  have to pull rather than push is left out, which is the closest the
+  lander can get; around 180 degrees that's nothing at all.
+
+  The drift is the one Sensed_VX() read when the turn was planned,
+  carried on with what the thrust set here pushes sideways (gravity
+  doesn't), so the velocity sensors aren't needed during the turn.
+*/
+void Turn_Thrust(void)
+{
+ double a = Turn_Angle() * PI / 180, sa = sin(a), ca = cos(a);
+ double ax, up, side, m = 0, l = 0, r = 0;
+
+ if (!turning) return;
+ turn_vx += turn_ax * (Events_Ticks() - thrust_tick) * T_STEP;
+ thrust_tick = Events_Ticks();
+
+ ax = fmax(-TURN_DRIFT_MAX, fmin(-turn_vx / TURN_DRIFT_TIME, TURN_DRIFT_MAX));
+ up = (ax * sa + G_ACCEL * ca) / MT_ACCEL;	// along the main thruster
+ side = ax * ca - G_ACCEL * sa;			// along the left thruster
+ if (MT_OK) Bus_Main(m = fmax(0, fmin(up, 1)));
+ if (LT_OK) Bus_Left(l = fmax(0, fmin(side / LT_ACCEL, 1)));
+ if (RT_OK) Bus_Right(r = fmax(0, fmin(-side / RT_ACCEL, 1)));
+ turn_ax = MT_ACCEL * m * sa + (LT_ACCEL * l - RT_ACCEL * r) * ca;
+}
+
+// Turn's over (or called off), hands the thrusters back switched off
+void Turn_End(void)
+{
+ if (!turning) return;
+ turning = 0;
+ Bus_Main(0);
+ Bus_Left(0);
+ Bus_Right(0);
+}
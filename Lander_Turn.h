@@ -0,0 +1,27 @@
+#ifndef _LANDER_TURN_H
+#define _LANDER_TURN_H
+
+/*
+  Thrust while turning.
+
+  Rotations go at most MAX_ROT_RATE per tick, so swapping to the
+  opposite thruster takes 40-odd ticks, and the controller used to
+  coast through them and lose 50+ pixels of altitude on every swap.
+  Set_Rotate() now plans each turn: since the lander turns at a known
+  rate, where it will be pointing on any tick of the turn is known in
+  advance. Turn_Thrust() uses that to aim whichever working thrusters
+  face the right way, to hold up against gravity and take out the
+  sideways drift the turn started with.
+
+  The profile reads the drift once, when the turn is planned, and
+  doesn't read Angle() or the velocity sensors while the turn is on.
+*/
+
+void Turn_Plan(double from, double delta);
+void Turn_To(double angle);
+double Turn_Angle(void);
+int Turn_Overdue(void);
+void Turn_Thrust(void);
+void Turn_End(void);
+
+#endif
@@ -0,0 +1,156 @@
+/*
+	Image loading for the simulator.
+
+	Lander_Control.o ships its own readPPMimage(); the build links a
+	copy of it (Lander_Sim.o) where that symbol is weak, so this
+	definition is the one the simulator calls for the map, the lander
+	sprite, the labels and the crash frames.
+
+	Besides regular .ppm files it accepts terrain specs such as
+	'gen:cave:42' (see Terrain_Gen.cpp), which are generated straight
+	into the simulator's image buffer without touching the disk, and
+	'tmap:' windows into tiled worlds (see Terrain_Tiles.h). The
+	standard images by their bare names come from the copies built
+	into the program (see Lander_Assets.h).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Lander_Assets.h"
+#include "Terrain_Gen.h"
+#include "Terrain_Tiles.h"
+
+#define SIM_MAP_SIZE 1024	// the simulator's world is fixed at 1024x1024
+
+static int Clamp_Window(int v, int size)
+{
+ if (v > size - SIM_MAP_SIZE) v = size - SIM_MAP_SIZE;
+ return v < 0 ? 0 : v;
+}
+
+/*
+  'tmap:world.tmap[@x,y]' flies the 1024x1024 window of a tiled world
+  whose top-left corner is (x, y). Without a corner the window is put
+  around the platform, with the usual spawn height of sky above it.
+  (The swarm flies a bare 'tmap:world.tmap' whole, see Lander_Swarm.h;
+  this window is what everything else gets.)
+*/
+static unsigned char *Read_Tile_Window(const char *spec)
+{
+ struct Tile_Map *m;
+ unsigned char *im;
+ char name[1024];
+ const char *at;
+ int x0, y0;
+
+ at = strchr(spec, '@');
+ snprintf(name, sizeof(name), "%.*s", at ? (int) (at - spec) : (int) strlen(spec), spec);
+ m = Tile_Map_Open(name);
+ if (!m) {
+  fprintf(stderr, "Unable to open tile map %s\n", name);
+  return NULL;
+ }
+ if (!at || sscanf(at + 1, "%d,%d", &x0, &y0) != 2) {
+  x0 = (int) m->terrain.plat_x - SIM_MAP_SIZE / 2;
+  y0 = m->terrain.plat_y + TERRAIN_PLAT_ROWS + 100 - SIM_MAP_SIZE;
+ }
+ x0 = Clamp_Window(x0, m->terrain.width);
+ y0 = Clamp_Window(y0, m->terrain.height);
+
+ im = (unsigned char *) malloc(SIM_MAP_SIZE * SIM_MAP_SIZE * 3);
+ if (im) Tile_Map_Window(m, x0, y0, SIM_MAP_SIZE, SIM_MAP_SIZE, im);
+ else fprintf(stderr, "Out of memory allocating space for image\n");
+ Tile_Map_Close(m);
+ return im;
+}
+
+// The image, and its size if width and height are given
+unsigned char *PPM_Read(const char *filename, int *width, int *height)
+{
+ FILE *f;
+ unsigned char *im;
+ char line[1024];
+ int sizx, sizy;
+ size_t n;
+
+ if (width) *width = *height = SIM_MAP_SIZE;	// unless it's a file
+
+ if (!strncmp(filename, "gen:", 4)) {
+  struct Terrain_Params p;
+  if (!Terrain_Parse(filename, &p)) {
+   fprintf(stderr, "Bad terrain spec %s\n", filename);
+   return NULL;
+  }
+  if (p.width != SIM_MAP_SIZE || p.height != SIM_MAP_SIZE) {
+   fprintf(stderr, "The simulator only flies %dx%d maps\n", SIM_MAP_SIZE, SIM_MAP_SIZE);
+   return NULL;
+  }
+  im = Terrain_Generate(&p);
+  if (!im) fprintf(stderr, "Out of memory allocating space for image\n");
+  return im;
+ }
+ if (!strncmp(filename, "tmap:", 5)) return Read_Tile_Window(filename + 5);
+
+ f = fopen(filename, "rb");
+ if (!f) {
+  fprintf(stderr, "Unable to open file %s for reading, please check name and path\n", filename);
+  return NULL;
+ }
+ if (!fgets(line, sizeof(line), f)) {
+  fprintf(stderr, "Failed to read .ppm header from %s\n", filename);
+  fclose(f);
+  return NULL;
+ }
+ if (strcmp(line, "P6\n")) {
+  fprintf(stderr, "Wrong file format, not a .ppm file or header end-of-line characters missing\n");
+  fclose(f);
+  return NULL;
+ }
+
+ // Skip comments, then read the size and the max value line
+ do {
+  if (!fgets(line, sizeof(line), f)) {
+   fprintf(stderr, "Failed to read header from .ppm file %s\n", filename);
+   fclose(f);
+   return NULL;
+  }
+ } while (line[0] == '#');
+ if (sscanf(line, "%d %d", &sizx, &sizy) != 2 || !fgets(line, sizeof(line), f)) {
+  fprintf(stderr, "Failed to read header from .ppm file %s\n", filename);
+  fclose(f);
+  return NULL;
+ }
+
+ if (width) {
+  *width = sizx;
+  *height = sizy;
+ }
+ n = (size_t) sizx * sizy * 3;
+ im = (unsigned char *) calloc(n, sizeof(unsigned char));
+ if (!im) {
+  fprintf(stderr, "Out of memory allocating space for image\n");
+  fclose(f);
+  return NULL;
+ }
+ if (fread(im, 1, n, f) != n) {
+  fprintf(stderr, "Failed to read data from .ppm file %s\n", filename);
+  free(im);
+  im = NULL;
+ }
+ fclose(f);
+ return im;
+}
+
+unsigned char *readPPMimage(const char *filename)
+{
+ struct Asset a;
+ unsigned char *im;
+
+ if (!Asset_Find(filename, &a)) return PPM_Read(filename, NULL, NULL);
+ im = (unsigned char *) malloc((size_t) a.width * a.height * 3);
+ if (im) memcpy(im, a.rgb, (size_t) a.width * a.height * 3);
+ else fprintf(stderr, "Out of memory allocating space for image\n");
+ return im;
+}
@@ -0,0 +1,381 @@
+/*
+	Procedural terrain generator for the lander simulation.
+
+	Builds occupancy maps directly in the simulator's image layout
+	(see Terrain_Gen.h) so new scenarios don't need a hand-drawn .ppm.
+	Everything is derived from the seed through a hash-based value
+	noise, so a (type, seed, parameters) triple names a map exactly.
+
+	Spec strings, as accepted by Terrain_Parse():
+
+	  gen:<fractal|cave|canyon>:<seed>[:key=value]...
+
+	  keys: w, h	  - map size in pixels (default 1024x1024)
+		px, pw	  - platform centre and width
+		shafts	  - number of narrow shafts (canyon: pinch points)
+		overhangs - number of overhanging ledges (caves grow
+			    their own)
+		rough	  - roughness in [0 1]
+
+	e.g.  Lander_Control gen:canyon:17:shafts=2 2
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Terrain_Gen.h"
+
+#define SLOT_MIN 130	// narrowest shaft opening, about what hard.ppm asks for
+#define MESA_HW 200	// half width of the mesa a shaft is cut through
+#define LEDGE_THICK 18
+#define PILLAR_W 24
+
+static const char *type_names[] = {"fractal", "cave", "canyon"};
+
+/*
+  Integer hash used as the source for all randomness, it is cheap and
+  has no state so any pixel (or any tile of a larger world) can be
+  evaluated on its own.
+*/
+static unsigned int Hash(unsigned int seed, int x, int y)
+{
+ unsigned int h = seed * 0x9e3779b9u;
+ h ^= (unsigned int) x * 0x85ebca6bu;
+ h ^= (unsigned int) y * 0xc2b2ae35u;
+ h ^= h >> 16;
+ h *= 0x7feb352du;
+ h ^= h >> 15;
+ h *= 0x846ca68bu;
+ h ^= h >> 16;
+ return h;
+}
+
+static double Rand01(unsigned int seed, int x, int y)
+{
+ return Hash(seed, x, y) / 4294967296.0;
+}
+
+static double Smooth(double t)
+{
+ return t * t * (3.0 - 2.0 * t);
+}
+
+// 1D value noise in [-1 1]
+static double Noise1(unsigned int seed, double x)
+{
+ double fx = floor(x);
+ int i = (int) fx;
+ double s = Smooth(x - fx);
+ double a = Rand01(seed, i, 0), b = Rand01(seed, i + 1, 0);
+ return 2.0 * (a + (b - a) * s) - 1.0;
+}
+
+// 2D value noise in [-1 1]
+static double Noise2(unsigned int seed, double x, double y)
+{
+ double fx = floor(x), fy = floor(y);
+ int i = (int) fx, j = (int) fy;
+ double sx = Smooth(x - fx), sy = Smooth(y - fy);
+ double a = Rand01(seed, i, j), b = Rand01(seed, i + 1, j);
+ double c = Rand01(seed, i, j + 1), d = Rand01(seed, i + 1, j + 1);
+ double top = a + (b - a) * sx, bot = c + (d - c) * sx;
+ return 2.0 * (top + (bot - top) * sy) - 1.0;
+}
+
+static double Fbm1(unsigned int seed, double x, int octaves)
+{
+ double sum = 0, amp = 1, norm = 0;
+ for (int o = 0; o < octaves; o++) {
+  sum += amp * Noise1(seed + o, x);
+  norm += amp;
+  amp *= 0.5;
+  x *= 2.0;
+ }
+ return sum / norm;
+}
+
+static double Fbm2(unsigned int seed, double x, double y, int octaves)
+{
+ double sum = 0, amp = 1, norm = 0;
+ for (int o = 0; o < octaves; o++) {
+  sum += amp * Noise2(seed + o, x, y);
+  norm += amp;
+  amp *= 0.5;
+  x *= 2.0;
+  y *= 2.0;
+ }
+ return sum / norm;
+}
+
+static double Clamp(double v, double lo, double hi)
+{
+ return (v < lo) ? lo : ((v > hi) ? hi : v);
+}
+
+static int Slot_HW(const struct Terrain_Params *p)
+{
+ return (p->plat_width + 60 > SLOT_MIN ? p->plat_width + 60 : SLOT_MIN) / 2;
+}
+
+// Ground height before the platform and shafts are cut in
+static double Base_Ground(const struct Terrain_Params *p, double x)
+{
+ double h = p->height;
+ return h * 0.80 + h * 0.10 * (0.3 + p->roughness) * Fbm1(p->seed + 11, x / 128.0, 5);
+}
+
+/*
+  Ground surface for column x: fractal ground, flattened under the
+  platform and raised into mesas around each shaft.
+*/
+double Terrain_Ground(const struct Terrain_Params *p, int x)
+{
+ double g = Base_Ground(p, x);
+ double d = fabs(x - p->plat_x) - p->plat_width / 2.0;
+
+ if (d < 60.0) {
+  double t = (d <= 0.0) ? 1.0 : Smooth(1.0 - d / 60.0);
+  g = g + (p->plat_y + TERRAIN_PLAT_ROWS - g) * t;
+ }
+
+ if (p->type == TERRAIN_FRACTAL) {
+  for (int i = 0; i < p->shafts; i++) {
+   double ds = fabs(x - p->shaft_x[i]);
+   if (ds < MESA_HW && ds >= Slot_HW(p)) {
+    double top = p->shaft_top[i] + 8.0 * p->roughness * Noise1(p->seed + 23 + i, x / 9.0);
+    if (top < g) g = top;
+   }
+  }
+ }
+ return g;
+}
+
+/*
+  Fills in the derived layout: platform height, shaft and ledge
+  positions. Must be called before the map is sampled.
+*/
+void Terrain_Resolve(struct Terrain_Params *p)
+{
+ unsigned int s = p->seed;
+ double w = p->width;
+ int n;
+
+ if (p->plat_width < 40) p->plat_width = 40;
+ if (p->shafts > TERRAIN_MAX_FEATURES) p->shafts = TERRAIN_MAX_FEATURES;
+ if (p->overhangs > TERRAIN_MAX_FEATURES) p->overhangs = TERRAIN_MAX_FEATURES;
+ p->roughness = Clamp(p->roughness, 0.0, 1.0);
+
+ if (p->plat_x < 0) p->plat_x = 120 + Rand01(s, 1, 1) * (w - 240);
+ p->plat_x = Clamp(p->plat_x, p->plat_width, w - p->plat_width);
+ p->plat_y = (int) Clamp(Base_Ground(p, p->plat_x), TERRAIN_SKY + 160, p->height - 40);
+
+ // Shafts: the first one sits over the platform, the rest are spread
+ // across the map without overlapping each other
+ n = 0;
+ for (int k = 0; n < p->shafts && k < 64; k++) {
+  double sx = (n == 0) ? p->plat_x : MESA_HW + Rand01(s, 2, k) * (w - 2 * MESA_HW);
+  int ok = 1;
+  for (int i = 0; i < n; i++)
+   if (fabs(sx - p->shaft_x[i]) < 2 * MESA_HW + 40) ok = 0;
+  if (!ok) continue;
+  p->shaft_x[n] = sx;
+  p->shaft_top[n] = fmax(TERRAIN_SKY + 60, p->plat_y - 150 - Rand01(s, 3, k) * 200);
+  n++;
+ }
+ p->shafts = n;
+
+ // Ledges stay clear of the column above the platform
+ n = 0;
+ for (int k = 0; n < p->overhangs && k < 64; k++) {
+  double len = 80 + Rand01(s, 5, k) * 120;
+  double lx = 40 + Rand01(s, 4, k) * (w - 80 - len);
+  if (lx + len > p->plat_x - p->plat_width && lx < p->plat_x + p->plat_width) continue;
+  p->ledge_x[n] = lx;
+  p->ledge_len[n] = len;
+  p->ledge_y[n] = TERRAIN_SKY + 40 + Rand01(s, 6, k) * (p->plat_y - TERRAIN_SKY - 160);
+  n++;
+ }
+ p->overhangs = n;
+}
+
+static int Cave_Open(const struct Terrain_Params *p, int x, int y)
+{
+ double t = Clamp((double) (y - TERRAIN_SKY) / (p->plat_y - TERRAIN_SKY), 0.0, 1.0);
+ double entry = p->width * (0.15 + 0.7 * Rand01(p->seed, 7, 0));
+ double cx = entry + (p->plat_x - entry) * Smooth(t);
+ cx += 90.0 * sin(M_PI * t) * Noise1(p->seed + 31, y / 160.0);
+ if (fabs(x - cx) < 70.0) return 1;
+ // headroom over the platform
+ if (fabs(x - p->plat_x) < p->plat_width / 2.0 + 40 && y > p->plat_y - 120) return 1;
+ return 0;
+}
+
+/*
+  Classifies pixel (x, y) given the ground height of its column (from
+  Terrain_Ground()). Pure function of the resolved parameters, so any
+  part of the map can be produced on its own.
+*/
+int Terrain_Cell(const struct Terrain_Params *p, double ground, int x, int y)
+{
+ if (fabs(x - p->plat_x) <= p->plat_width / 2.0 && y >= p->plat_y && y < p->plat_y + TERRAIN_PLAT_ROWS)
+  return TERRAIN_PLATFORM;
+ if (y >= ground) return TERRAIN_ROCK;
+ if (y < TERRAIN_SKY) return TERRAIN_EMPTY;
+
+ if (p->type == TERRAIN_CAVE) {
+  double roof = TERRAIN_SKY + 40.0 + 40.0 * Fbm1(p->seed + 43, x / 90.0, 4);
+  double depth = Clamp((y - roof) / 60.0, 0.0, 1.0);
+  double dens = Fbm2(p->seed + 41, x / 170.0, y / 170.0, 4) + 0.35 * depth - 0.25 + 0.2 * p->roughness;
+  if (depth > 0 && dens > 0 && !Cave_Open(p, x, y)) return TERRAIN_ROCK;
+ } else if (p->type == TERRAIN_CANYON) {
+  double rim = TERRAIN_SKY + 40;
+  double t = Clamp((y - rim) / (p->plat_y - rim), 0.0, 1.0);
+  double c = p->width / 2.0 + (p->plat_x - p->width / 2.0) * Smooth(t);
+  c += sin(M_PI * t) * 120.0 * Fbm1(p->seed + 51, y / 220.0, 3);
+  double hw = (p->width * 0.30) * (1.0 - t) + (p->plat_width / 2.0 + 60) * t;
+  hw += 25.0 * p->roughness * Fbm1(p->seed + 53, y / 35.0, 3);
+  for (int i = 0; i < p->shafts; i++) {
+   double py = TERRAIN_SKY + (i + 1) * (p->plat_y - TERRAIN_SKY) / (p->shafts + 1.0);
+   if (fabs(y - py) < 40) hw = fmin(hw, Slot_HW(p));
+  }
+  for (int i = 0; i < p->overhangs; i++) {
+   double dy = y - p->ledge_y[i];
+   if (dy > 0 && dy < LEDGE_THICK) {
+    // Ledges alternate sides and reach into the canyon
+    int side = (i & 1) ? 1 : -1;
+    if ((x - c) * side > 0) hw = fmax(Slot_HW(p), hw - p->ledge_len[i] * 0.5);
+   }
+  }
+  if (y > rim && fabs(x - c) > hw) return TERRAIN_ROCK;
+ }
+
+ if (p->type == TERRAIN_FRACTAL) {
+  for (int i = 0; i < p->overhangs; i++) {
+   double lx = p->ledge_x[i], ly = p->ledge_y[i];
+   if (x < lx || x > lx + p->ledge_len[i] || y < ly) continue;
+   if (x < lx + PILLAR_W) return TERRAIN_ROCK;
+   if (y < ly + LEDGE_THICK + 6.0 * Noise1(p->seed + 61 + i, x / 11.0)) return TERRAIN_ROCK;
+  }
+ }
+ return TERRAIN_EMPTY;
+}
+
+void Terrain_Rock_Colour(const struct Terrain_Params *p, int x, int y, unsigned char *rgb)
+{
+ double shade = 0.85 + 0.15 * Noise2(p->seed + 71, x / 3.0, y / 3.0) + 0.12 * Noise2(p->seed + 73, x / 19.0, y / 19.0);
+ rgb[0] = (unsigned char) Clamp(138.0 * shade, 48, 170);
+ rgb[1] = (unsigned char) Clamp(95.0 * shade, 20, 120);
+ rgb[2] = (unsigned char) Clamp(66.0 * shade, 10, 90);
+}
+
+/*
+  Sets sensible defaults for a terrain type. Callers may override any
+  of the fields before Terrain_Generate().
+*/
+void Terrain_Defaults(struct Terrain_Params *p, int type, unsigned int seed)
+{
+ memset(p, 0, sizeof(*p));
+ p->type = type;
+ p->width = 1024;
+ p->height = 1024;
+ p->seed = seed;
+ p->roughness = 0.5;
+ p->plat_x = -1;
+ p->plat_width = 80;
+ p->shafts = (type == TERRAIN_CAVE) ? 0 : 1;
+ p->overhangs = (type == TERRAIN_CAVE) ? 0 : 2;
+}
+
+/*
+  Parses a 'gen:<type>:<seed>[:key=value]...' spec. Returns 1 on
+  success, 0 if the string is not a terrain spec or is malformed.
+*/
+int Terrain_Parse(const char *spec, struct Terrain_Params *p)
+{
+ char buf[256], *tok, *save;
+ int type = -1;
+
+ if (strncmp(spec, "gen:", 4) || strlen(spec) >= sizeof(buf)) return 0;
+ strcpy(buf, spec + 4);
+
+ tok = strtok_r(buf, ":", &save);
+ if (!tok) return 0;
+ for (int i = 0; i < 3; i++)
+  if (!strcmp(tok, type_names[i])) type = i;
+ if (type < 0) return 0;
+
+ tok = strtok_r(NULL, ":", &save);
+ Terrain_Defaults(p, type, tok ? (unsigned int) strtoul(tok, NULL, 10) : 0);
+
+ while ((tok = strtok_r(NULL, ":", &save))) {
+  char *eq = strchr(tok, '=');
+  double v;
+  if (!eq) return 0;
+  *eq = 0;
+  v = atof(eq + 1);
+  if (!strcmp(tok, "w")) p->width = (int) v;
+  else if (!strcmp(tok, "h")) p->height = (int) v;
+  else if (!strcmp(tok, "px")) p->plat_x = v;
+  else if (!strcmp(tok, "pw")) p->plat_width = (int) v;
+  else if (!strcmp(tok, "shafts")) p->shafts = (int) v;
+  else if (!strcmp(tok, "overhangs")) p->overhangs = (int) v;
+  else if (!strcmp(tok, "rough")) p->roughness = v;
+  else return 0;
+ }
+ return (p->width >= 256 && p->height >= 512);
+}
+
+/*
+  Generates the map described by p (resolving its layout first).
+  Returns a calloc()ed width*height*3 RGB buffer, or NULL if out of
+  memory.
+*/
+unsigned char *Terrain_Generate(struct Terrain_Params *p)
+{
+ unsigned char *rgb;
+ double *ground;
+
+ Terrain_Resolve(p);
+
+ rgb = (unsigned char *) calloc((size_t) p->width * p->height * 3, sizeof(unsigned char));
+ ground = (double *) malloc(p->width * sizeof(double));
+ if (!rgb || !ground) {
+  free(rgb);
+  free(ground);
+  return NULL;
+ }
+ for (int x = 0; x < p->width; x++)
+  ground[x] = Terrain_Ground(p, x);
+
+ for (int y = 0; y < p->height; y++) {
+  unsigned char *row = rgb + (size_t) y * p->width * 3;
+  for (int x = 0; x < p->width; x++) {
+   switch (Terrain_Cell(p, ground[x], x, y)) {
+    case TERRAIN_ROCK:
+     Terrain_Rock_Colour(p, x, y, row + 3 * x);
+     break;
+    case TERRAIN_PLATFORM:
+     row[3 * x] = 255;
+     break;
+   }
+  }
+ }
+ free(ground);
+ return rgb;
+}
+
+// Writes an RGB buffer as a binary .ppm the simulator can load
+int Terrain_Write_PPM(const char *filename, const unsigned char *rgb, int width, int height)
+{
+ FILE *f = fopen(filename, "wb");
+ size_t n = (size_t) width * height * 3;
+ if (!f) return 0;
+ fprintf(f, "P6\n# Terrain_Gen\n%d %d\n255\n", width, height);
+ if (fwrite(rgb, 1, n, f) != n) {
+  fclose(f);
+  return 0;
+ }
+ return fclose(f) == 0;
+}
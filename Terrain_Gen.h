@@ -0,0 +1,61 @@
+#ifndef _TERRAIN_GEN_H
+#define _TERRAIN_GEN_H
+
+/*
+  Procedural terrain for the lander simulation.
+
+  Maps are produced in the same layout the simulator keeps in memory
+  after readPPMimage(): width*height RGB triplets, row-major, y growing
+  downward. Empty space is black, rock is a brown texture (red channel
+  always > 5 so RangeDist() and the sonar see it), and the landing
+  platform is pure red (the simulator locates PLAT_X/PLAT_Y as the
+  centroid of pixels with R > 250, G < 10, B < 10).
+
+  A terrain is fully determined by its Terrain_Params, so the same
+  seed always gives the same map.
+*/
+
+// Terrain families
+#define TERRAIN_FRACTAL 0	// rolling fractal ground, mesas with shafts, ledges
+#define TERRAIN_CAVE 1		// fractal cave system with a carved approach tunnel
+#define TERRAIN_CANYON 2	// meandering canyon narrowing down to the platform
+
+// Pixel classes
+#define TERRAIN_EMPTY 0
+#define TERRAIN_ROCK 1
+#define TERRAIN_PLATFORM 2
+
+#define TERRAIN_MAX_FEATURES 8
+#define TERRAIN_SKY 180		// rows kept clear at the top (the lander spawns at y 50-100)
+#define TERRAIN_PLAT_ROWS 5	// thickness of the red platform
+
+struct Terrain_Params {
+ int type;
+ int width;
+ int height;
+ unsigned int seed;
+ double roughness;	// 0 - flat, 1 - very jagged
+ double plat_x;		// platform centre, < 0 picks one from the seed
+ int plat_width;
+ int shafts;		// narrow vertical shafts cut through raised mesas
+ int overhangs;		// ledges hanging over open ground
+
+ // Filled in by Terrain_Resolve()
+ int plat_y;		// top row of the platform
+ double shaft_x[TERRAIN_MAX_FEATURES];
+ double shaft_top[TERRAIN_MAX_FEATURES];
+ double ledge_x[TERRAIN_MAX_FEATURES];
+ double ledge_y[TERRAIN_MAX_FEATURES];
+ double ledge_len[TERRAIN_MAX_FEATURES];
+};
+
+void Terrain_Defaults(struct Terrain_Params *p, int type, unsigned int seed);
+int Terrain_Parse(const char *spec, struct Terrain_Params *p);
+void Terrain_Resolve(struct Terrain_Params *p);
+unsigned char *Terrain_Generate(struct Terrain_Params *p);
+double Terrain_Ground(const struct Terrain_Params *p, int x);
+int Terrain_Cell(const struct Terrain_Params *p, double ground, int x, int y);
+void Terrain_Rock_Colour(const struct Terrain_Params *p, int x, int y, unsigned char *rgb);
+int Terrain_Write_PPM(const char *filename, const unsigned char *rgb, int width, int height);
+
+#endif
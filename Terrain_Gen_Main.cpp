@@ -0,0 +1,61 @@
+/*
+	Command line front end for the terrain generator.
+
+	Usage: Terrain_Gen spec output.ppm|output.tmap
+
+	e.g.   Terrain_Gen gen:fractal:7:w=4096:h=4096:shafts=4 big.ppm
+	       Terrain_Gen gen:canyon:3:w=16384:h=16384 world.tmap
+
+	Writes the map as a .ppm (handy for looking at a seed, or for
+	benchmarking code against maps larger than the simulator's) or as
+	a tiled world (see Terrain_Tiles.h) and reports where the platform
+	ended up.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Terrain_Gen.h"
+#include "Terrain_Tiles.h"
+
+int main(int argc, char *argv[])
+{
+ struct Terrain_Params p;
+ unsigned char *rgb;
+ size_t len;
+
+ if (argc != 3) {
+  fprintf(stderr, "Usage: Terrain_Gen gen:<fractal|cave|canyon>:<seed>[:key=value]... output.ppm|output.tmap\n");
+  return 1;
+ }
+ if (!Terrain_Parse(argv[1], &p)) {
+  fprintf(stderr, "Bad terrain spec %s\n", argv[1]);
+  return 1;
+ }
+
+ // Tiled worlds are built a strip at a time, never as one big image
+ len = strlen(argv[2]);
+ if (len > 5 && !strcmp(argv[2] + len - 5, ".tmap")) {
+  if (!Tile_Map_Build(&p, argv[2])) {
+   fprintf(stderr, "Unable to write %s\n", argv[2]);
+   return 1;
+  }
+  printf("%dx%d, platform at (%.0f, %d)\n", p.width, p.height, p.plat_x, p.plat_y + TERRAIN_PLAT_ROWS / 2);
+  return 0;
+ }
+
+ rgb = Terrain_Generate(&p);
+ if (!rgb) {
+  fprintf(stderr, "Out of memory allocating space for image\n");
+  return 1;
+ }
+ if (!Terrain_Write_PPM(argv[2], rgb, p.width, p.height)) {
+  fprintf(stderr, "Unable to write %s\n", argv[2]);
+  free(rgb);
+  return 1;
+ }
+ printf("%dx%d, platform at (%.0f, %d)\n", p.width, p.height, p.plat_x, p.plat_y + TERRAIN_PLAT_ROWS / 2);
+ free(rgb);
+ return 0;
+}
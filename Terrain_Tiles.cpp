@@ -0,0 +1,284 @@
+/*
+	Tiled world storage (see Terrain_Tiles.h).
+
+	Worlds are built tile row by tile row straight from the terrain
+	generator, so building a 16k x 16k world never holds more than one
+	row of tiles in memory. Queries (pixel lookups, whether a box has
+	anything in it, a row of pixels against the lander's hull, and
+	rendering a window of the world into the simulator's RGB layout)
+	only touch the tiles they cross, and empty or solid tiles are
+	answered from the summary without reading their bits at all.
+*/
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Terrain_Tiles.h"
+
+#define TMAP_MAGIC "LANDTMAP"
+#define TMAP_ALIGN 4096
+
+struct Tile_File_Header {
+ char magic[8];
+ int tile_size;
+ int tiles_x;
+ int tiles_y;
+ int pad;
+ struct Terrain_Params terrain;
+ long long summary_off;
+ long long bits_off;
+};
+
+static long long Align(long long v)
+{
+ return (v + TMAP_ALIGN - 1) / TMAP_ALIGN * TMAP_ALIGN;
+}
+
+static int On_Platform(const struct Terrain_Params *p, int x, int y)
+{
+ return fabs(x - p->plat_x) <= p->plat_width / 2.0 && y >= p->plat_y && y < p->plat_y + TERRAIN_PLAT_ROWS;
+}
+
+// 1 if spec is a whole tiled world ('tmap:world.tmap'), not a window of one
+int Tile_Map_Whole(const char *spec)
+{
+ return !strncmp(spec, "tmap:", 5) && !strchr(spec, '@');
+}
+
+/*
+  Generates the world described by p into a .tmap file. Returns 1 on
+  success.
+*/
+int Tile_Map_Build(struct Terrain_Params *p, const char *filename)
+{
+ struct Tile_File_Header hdr;
+ unsigned char *summary;
+ unsigned long long *row;
+ double *ground;
+ FILE *f;
+ int ok = 1;
+
+ Terrain_Resolve(p);
+
+ memset(&hdr, 0, sizeof(hdr));
+ memcpy(hdr.magic, TMAP_MAGIC, 8);
+ hdr.tile_size = TILE_SIZE;
+ hdr.tiles_x = (p->width + TILE_SIZE - 1) / TILE_SIZE;
+ hdr.tiles_y = (p->height + TILE_SIZE - 1) / TILE_SIZE;
+ hdr.terrain = *p;
+ hdr.summary_off = Align(sizeof(hdr));
+ hdr.bits_off = Align(hdr.summary_off + (long long) hdr.tiles_x * hdr.tiles_y);
+
+ f = fopen(filename, "wb");
+ summary = (unsigned char *) calloc((size_t) hdr.tiles_x * hdr.tiles_y, 1);
+ row = (unsigned long long *) malloc((size_t) hdr.tiles_x * TILE_BYTES);
+ ground = (double *) malloc(p->width * sizeof(double));
+ if (!f || !summary || !row || !ground) {
+  if (f) fclose(f);
+  free(summary);
+  free(row);
+  free(ground);
+  return 0;
+ }
+
+ for (int x = 0; x < p->width; x++)
+  ground[x] = Terrain_Ground(p, x);
+
+ for (int ty = 0; ty < hdr.tiles_y && ok; ty++) {
+  memset(row, 0, (size_t) hdr.tiles_x * TILE_BYTES);
+  for (int j = 0; j < TILE_SIZE; j++) {
+   int y = ty * TILE_SIZE + j;
+   if (y >= p->height) break;
+   for (int x = 0; x < p->width; x++)
+    if (Terrain_Cell(p, ground[x], x, y) != TERRAIN_EMPTY)
+     row[(x / TILE_SIZE) * TILE_SIZE + j] |= 1ULL << (x % TILE_SIZE);
+  }
+  for (int tx = 0; tx < hdr.tiles_x; tx++) {
+   int n = 0;
+   for (int j = 0; j < TILE_SIZE; j++)
+    n += __builtin_popcountll(row[tx * TILE_SIZE + j]);
+   summary[ty * hdr.tiles_x + tx] = (n == 0) ? TILE_EMPTY : ((n == TILE_SIZE * TILE_SIZE) ? TILE_SOLID : TILE_MIXED);
+  }
+  if (fseek(f, hdr.bits_off + (long long) ty * hdr.tiles_x * TILE_BYTES, SEEK_SET) ||
+      fwrite(row, TILE_BYTES, hdr.tiles_x, f) != (size_t) hdr.tiles_x) ok = 0;
+ }
+
+ if (ok) {
+  ok = !fseek(f, 0, SEEK_SET) && fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+       !fseek(f, hdr.summary_off, SEEK_SET) &&
+       fwrite(summary, 1, (size_t) hdr.tiles_x * hdr.tiles_y, f) == (size_t) hdr.tiles_x * hdr.tiles_y;
+ }
+ if (fclose(f)) ok = 0;
+ free(summary);
+ free(row);
+ free(ground);
+ return ok;
+}
+
+/*
+  Maps a .tmap file. Nothing but the header is read here, tiles are
+  paged in on first use. Returns NULL if the file is missing or is not
+  a tile map.
+*/
+struct Tile_Map *Tile_Map_Open(const char *filename)
+{
+ struct Tile_File_Header *hdr;
+ struct Tile_Map *m;
+ struct stat st;
+ void *base;
+ int fd;
+
+ fd = open(filename, O_RDONLY);
+ if (fd < 0) return NULL;
+ if (fstat(fd, &st) || st.st_size < (off_t) sizeof(*hdr)) {
+  close(fd);
+  return NULL;
+ }
+ base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+ close(fd);
+ if (base == MAP_FAILED) return NULL;
+
+ hdr = (struct Tile_File_Header *) base;
+ if (memcmp(hdr->magic, TMAP_MAGIC, 8) || hdr->tile_size != TILE_SIZE ||
+     hdr->bits_off + (long long) hdr->tiles_x * hdr->tiles_y * TILE_BYTES > st.st_size ||
+     !(m = (struct Tile_Map *) malloc(sizeof(*m)))) {
+  munmap(base, st.st_size);
+  return NULL;
+ }
+ // Queries jump around the file, read-ahead would only load tiles we don't need
+ madvise(base, st.st_size, MADV_RANDOM);
+
+ m->terrain = hdr->terrain;
+ m->tiles_x = hdr->tiles_x;
+ m->tiles_y = hdr->tiles_y;
+ m->summary = (const unsigned char *) base + hdr->summary_off;
+ m->bits = (const unsigned long long *) ((const char *) base + hdr->bits_off);
+ m->base = base;
+ m->length = st.st_size;
+ return m;
+}
+
+void Tile_Map_Close(struct Tile_Map *m)
+{
+ if (!m) return;
+ munmap(m->base, m->length);
+ free(m);
+}
+
+// Returns TERRAIN_EMPTY, TERRAIN_ROCK or TERRAIN_PLATFORM, outside the world is empty
+int Tile_Map_Cell(const struct Tile_Map *m, int x, int y)
+{
+ if (!Tile_Map_Solid(m, x, y)) return TERRAIN_EMPTY;
+ return On_Platform(&m->terrain, x, y) ? TERRAIN_PLATFORM : TERRAIN_ROCK;
+}
+
+// 1 if there's nothing at all in [x0, x1] x [y0, y1], going by the summary
+int Tile_Map_Empty(const struct Tile_Map *m, int x0, int y0, int x1, int y1)
+{
+ if (x0 < 0) x0 = 0;
+ if (y0 < 0) y0 = 0;
+ if (x1 >= m->terrain.width) x1 = m->terrain.width - 1;
+ if (y1 >= m->terrain.height) y1 = m->terrain.height - 1;
+ if (x0 > x1 || y0 > y1) return 1;
+
+ for (int ty = y0 / TILE_SIZE; ty <= y1 / TILE_SIZE; ty++)
+  for (int tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; tx++)
+   if (m->summary[ty * m->tiles_x + tx] != TILE_EMPTY) return 0;
+ return 1;
+}
+
+// Row y of tile column tx, bit c for pixel tx * TILE_SIZE + c
+static unsigned long long Tile_Word(const struct Tile_Map *m, int tx, int y)
+{
+ int t;
+
+ if (tx < 0 || tx >= m->tiles_x) return 0;
+ t = (y / TILE_SIZE) * m->tiles_x + tx;
+ if (m->summary[t] != TILE_MIXED) return m->summary[t] == TILE_SOLID ? ~0ULL : 0;
+ return m->bits[t * TILE_SIZE + y % TILE_SIZE];
+}
+
+/*
+  Pixels x to x + 63 of row y, bit c for pixel x + c: the rock's are
+  returned and the platform's put in *pad (the two never share a
+  pixel). Off the world reads as empty.
+*/
+unsigned long long Tile_Map_Row(const struct Tile_Map *m, int x, int y, unsigned long long *pad)
+{
+ const struct Terrain_Params *p = &m->terrain;
+ int tx = x >= 0 ? x / TILE_SIZE : -((TILE_SIZE - 1 - x) / TILE_SIZE), sh = x - tx * TILE_SIZE;
+ unsigned long long lo, hi, solid, plat = 0;
+
+ *pad = 0;
+ if (y < 0 || y >= p->height) return 0;
+ lo = Tile_Word(m, tx, y);
+ hi = Tile_Word(m, tx + 1, y);
+ solid = sh ? lo >> sh | hi << (TILE_SIZE - sh) : lo;
+ if (y >= p->plat_y && y < p->plat_y + TERRAIN_PLAT_ROWS) {
+  int a = (int) ceil(p->plat_x - p->plat_width / 2.0) - x, b = (int) floor(p->plat_x + p->plat_width / 2.0) - x;
+
+  if (a < 0) a = 0;
+  if (b > 63) b = 63;
+  if (a <= b) plat = (~0ULL >> (63 - (b - a))) << a;
+ }
+ *pad = solid & plat;
+ return solid & ~plat;
+}
+
+// Same rule as the simulator, the centroid of the platform's pixels
+void Tile_Map_Platform(const struct Tile_Map *m, double *plat_x, double *plat_y)
+{
+ const struct Terrain_Params *p = &m->terrain;
+ int a = (int) ceil(p->plat_x - p->plat_width / 2.0), b = (int) floor(p->plat_x + p->plat_width / 2.0);
+
+ if (a < 0) a = 0;
+ if (b >= p->width) b = p->width - 1;
+ *plat_x = (a + b) / 2.0;
+ *plat_y = p->plat_y + (TERRAIN_PLAT_ROWS - 1) / 2.0;
+}
+
+/*
+  Renders the w x h window with top-left corner (x0, y0) into rgb
+  (w*h*3 bytes, simulator layout). Only tiles overlapping the window
+  are visited.
+*/
+void Tile_Map_Window(const struct Tile_Map *m, int x0, int y0, int w, int h, unsigned char *rgb)
+{
+ const struct Terrain_Params *p = &m->terrain;
+ int tx0, ty0, tx1, ty1;
+
+ memset(rgb, 0, (size_t) w * h * 3);
+ tx0 = (x0 < 0 ? 0 : x0) / TILE_SIZE;
+ ty0 = (y0 < 0 ? 0 : y0) / TILE_SIZE;
+ tx1 = (x0 + w - 1) / TILE_SIZE;
+ ty1 = (y0 + h - 1) / TILE_SIZE;
+ if (tx1 >= m->tiles_x) tx1 = m->tiles_x - 1;
+ if (ty1 >= m->tiles_y) ty1 = m->tiles_y - 1;
+
+ for (int ty = ty0; ty <= ty1; ty++) {
+  for (int tx = tx0; tx <= tx1; tx++) {
+   int tile = ty * m->tiles_x + tx;
+   if (m->summary[tile] == TILE_EMPTY) continue;
+   for (int j = 0; j < TILE_SIZE; j++) {
+    int y = ty * TILE_SIZE + j;
+    unsigned long long bits;
+    if (y < y0 || y >= y0 + h || y >= p->height) continue;
+    bits = (m->summary[tile] == TILE_SOLID) ? ~0ULL : m->bits[tile * TILE_SIZE + j];
+    while (bits) {
+     int x = tx * TILE_SIZE + __builtin_ctzll(bits);
+     bits &= bits - 1;
+     if (x < x0 || x >= x0 + w || x >= p->width) continue;
+     unsigned char *px = rgb + ((size_t) (y - y0) * w + (x - x0)) * 3;
+     if (On_Platform(p, x, y)) px[0] = 255;
+     else Terrain_Rock_Colour(p, x, y, px);
+    }
+   }
+  }
+ }
+}
@@ -0,0 +1,65 @@
+#ifndef _TERRAIN_TILES_H
+#define _TERRAIN_TILES_H
+
+/*
+  Tiled occupancy storage for worlds much larger than the 1024x1024
+  image the simulator keeps in memory.
+
+  A .tmap file holds one bit per pixel grouped into TILE_SIZE x
+  TILE_SIZE tiles (512 bytes each, stored contiguously), plus a one
+  byte summary per tile saying whether it is empty, solid or mixed.
+  Files are mmap()ed, so only the tiles a query actually touches are
+  ever read from disk; a 16k x 16k world is 32 MB on disk instead of
+  768 MB of RGB.
+
+  The swarm flies a whole tiled world ('tmap:world.tmap', see
+  Lander_Swarm.h) with its collisions, sonar and RangeDist() asking
+  the tiles around each lander. The simulator's world is fixed at
+  1024x1024, so readPPMimage() hands it a window of one instead
+  (Map_Loader.cpp).
+*/
+
+#include <stddef.h>
+
+#include "Terrain_Gen.h"
+
+#define TILE_SIZE 64
+#define TILE_BYTES (TILE_SIZE * TILE_SIZE / 8)
+
+// Tile summary values
+#define TILE_EMPTY 0
+#define TILE_SOLID 1
+#define TILE_MIXED 2
+
+struct Tile_Map {
+ struct Terrain_Params terrain;		// what the world was generated from
+ int tiles_x;
+ int tiles_y;
+ const unsigned char *summary;		// tiles_x * tiles_y entries
+ const unsigned long long *bits;	// TILE_SIZE words per tile, bit x of word y
+ void *base;
+ size_t length;
+};
+
+int Tile_Map_Whole(const char *spec);
+int Tile_Map_Build(struct Terrain_Params *p, const char *filename);
+struct Tile_Map *Tile_Map_Open(const char *filename);
+void Tile_Map_Close(struct Tile_Map *m);
+int Tile_Map_Cell(const struct Tile_Map *m, int x, int y);
+int Tile_Map_Empty(const struct Tile_Map *m, int x0, int y0, int x1, int y1);
+unsigned long long Tile_Map_Row(const struct Tile_Map *m, int x, int y, unsigned long long *pad);
+void Tile_Map_Platform(const struct Tile_Map *m, double *plat_x, double *plat_y);
+void Tile_Map_Window(const struct Tile_Map *m, int x0, int y0, int w, int h, unsigned char *rgb);
+
+// 1 if pixel (x, y) is rock or platform, outside the world is empty
+static inline int Tile_Map_Solid(const struct Tile_Map *m, int x, int y)
+{
+ int t;
+
+ if (x < 0 || y < 0 || x >= m->terrain.width || y >= m->terrain.height) return 0;
+ t = (y / TILE_SIZE) * m->tiles_x + x / TILE_SIZE;
+ if (m->summary[t] != TILE_MIXED) return m->summary[t] == TILE_SOLID;
+ return (m->bits[t * TILE_SIZE + y % TILE_SIZE] >> (x % TILE_SIZE)) & 1;
+}
+
+#endif